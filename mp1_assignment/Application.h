@@ -14,11 +14,12 @@
 #include "Member.h"
 #include "EmulNet.h"
 #include "Queue.h"
+#include "ThreadPool.h"
 
 /**
  * global variables
  */
-int nodeCount = 0;
+atomic<int> nodeCount(0);
 
 /*
  * Macros
@@ -26,6 +27,16 @@ int nodeCount = 0;
 #define ARGS_COUNT 2
 #define TOTAL_RUNNING_TIME 700
 
+/**
+ * Struct Name: change_logger
+ *
+ * DESCRIPTION: Where the membership changes of one node are logged
+ */
+typedef struct change_logger {
+	Log *log;
+	Address *addr;
+}change_logger;
+
 /**
  * CLASS NAME: Application
  *
@@ -39,7 +50,15 @@ private:
 	EmulNet *en;
     Log *log;
 	MP1Node **mp1;
+	change_logger *loggers;
 	Params *par;
+	// with THREADS, the workers the nodes of a tick are spread over
+	ThreadPool pool;
+	static void logChanges(void *env, const MemberChange *changes, int count);
+	static void recvTask(void *env, int begin, int end);
+	static void loopTask(void *env, int begin, int end);
+	void recvNode(int i);
+	void loopNode(int i);
 public:
 	Application(char *);
 	virtual ~Application();
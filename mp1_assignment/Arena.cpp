@@ -0,0 +1,73 @@
+/**********************************
+ * FILE NAME: Arena.cpp
+ *
+ * DESCRIPTION: Definition of Arena class
+ **********************************/
+
+#include "Arena.h"
+
+/**
+ * Constructor
+ */
+Arena::Arena(): chunk(0), used(0) {}
+
+/**
+ * Destructor
+ */
+Arena::~Arena() {
+	for ( unsigned int i = 0; i < chunks.size(); i++ ) {
+		free(chunks[i]);
+	}
+}
+
+/**
+ * FUNCTION NAME: alloc
+ *
+ * DESCRIPTION: Return size bytes, aligned to ARENA_ALIGN, valid until the next reset
+ */
+void *Arena::alloc(size_t size) {
+	size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+	// move on to the next chunk that has room, allocating one if none is left
+	while ( chunk < (int)chunks.size() && used + size > sizes[chunk] ) {
+		chunk++;
+		used = 0;
+	}
+	if ( chunk == (int)chunks.size() ) {
+		// each chunk at least doubles the last one, so requests that grow from
+		// round to round end up in a few large chunks instead of one new chunk
+		// per round
+		size_t chunkSize = max(size, (size_t)ARENA_CHUNK_SIZE);
+		if ( !sizes.empty() ) {
+			chunkSize = max(chunkSize, 2 * sizes.back());
+		}
+		chunks.push_back((char *) malloc(chunkSize));
+		sizes.push_back(chunkSize);
+		used = 0;
+	}
+	void *p = chunks[chunk] + used;
+	used += size;
+	return p;
+}
+
+/**
+ * FUNCTION NAME: reset
+ *
+ * DESCRIPTION: Drop every allocation; the chunks are kept for reuse
+ */
+void Arena::reset() {
+	chunk = 0;
+	used = 0;
+}
+
+/**
+ * FUNCTION NAME: capacity
+ *
+ * DESCRIPTION: Return the bytes held in chunks
+ */
+size_t Arena::capacity() {
+	size_t total = 0;
+	for ( unsigned int i = 0; i < sizes.size(); i++ ) {
+		total += sizes[i];
+	}
+	return total;
+}
@@ -0,0 +1,53 @@
+/**********************************
+ * FILE NAME: Arena.h
+ *
+ * DESCRIPTION: Header file of Arena class
+ **********************************/
+
+#ifndef _ARENA_H_
+#define _ARENA_H_
+
+#include "stdincludes.h"
+
+/*
+ * Macros
+ */
+// size of the first arena chunk; every further chunk is at least twice the last
+#define ARENA_CHUNK_SIZE 16384
+// alignment of every allocation
+#define ARENA_ALIGN 16
+
+/**
+ * CLASS NAME: Arena
+ *
+ * DESCRIPTION: Bump-pointer allocator for short-lived scratch objects.
+ * 				Allocations are never freed one by one; reset() drops them
+ * 				all at once and keeps the chunks for reuse, so a steady
+ * 				workload stops calling malloc after its first few rounds.
+ * 				Destructors are not run, so only objects that need none
+ * 				belong here.
+ */
+class Arena {
+private:
+	vector<char *> chunks;
+	vector<size_t> sizes;
+	// chunk being carved, and bytes used in it
+	int chunk;
+	size_t used;
+public:
+	Arena();
+	virtual ~Arena();
+	void *alloc(size_t size);
+	void reset();
+	size_t capacity();
+	// default constructed array of n objects of type T
+	template <class T> T *allocArray(int n) {
+		T *array = (T *) alloc(max(n, 1) * sizeof(T));
+		for ( int i = 0; i < n; i++ ) {
+			new (&array[i]) T();
+		}
+		return array;
+	}
+};
+
+#endif /* _ARENA_H_ */
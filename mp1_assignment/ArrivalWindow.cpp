@@ -0,0 +1,88 @@
+/**********************************
+ * FILE NAME: ArrivalWindow.cpp
+ *
+ * DESCRIPTION: Definition of ArrivalWindow class
+ **********************************/
+
+#include "ArrivalWindow.h"
+
+/**
+ * Constructor
+ */
+ArrivalWindow::ArrivalWindow(): count(0), next(0), sum(0), sumSq(0), last(-1) {}
+
+/**
+ * FUNCTION NAME: arrival
+ *
+ * DESCRIPTION: Record a heartbeat heard at time now. Several in the same tick
+ * 				count as one.
+ */
+void ArrivalWindow::arrival(long now) {
+	if ( last >= 0 && now > last ) {
+		int interval = (int)(now - last);
+		if ( count == PHI_WINDOW ) {
+			sum -= samples[next];
+			sumSq -= (long)samples[next] * samples[next];
+		}
+		else {
+			count++;
+		}
+		samples[next] = interval;
+		sum += interval;
+		sumSq += (long)interval * interval;
+		next = (next + 1) % PHI_WINDOW;
+	}
+	last = max(last, now);
+}
+
+/**
+ * FUNCTION NAME: size
+ *
+ * DESCRIPTION: Return the number of inter-arrival times kept
+ */
+int ArrivalWindow::size() {
+	return count;
+}
+
+/**
+ * FUNCTION NAME: phi
+ *
+ * DESCRIPTION: Suspicion level at time now, with the normal distribution of the
+ * 				inter-arrival times approximated by a logistic function. 0 without
+ * 				enough samples.
+ */
+double ArrivalWindow::phi(long now) {
+	if ( count < PHI_MIN_SAMPLES ) {
+		return 0;
+	}
+	double mean = (double)sum / count;
+	double variance = (double)sumSq / count - mean * mean;
+	double stddev = max(PHI_MIN_STDDEV, sqrt(max(0.0, variance)));
+	double expected = mean + PHI_PAUSE;
+	double y = ((double)(now - last) - expected) / stddev;
+	double e = exp(-y * (1.5976 + 0.070566 * y * y));
+	if ( now - last > expected ) {
+		return -log10(e / (1.0 + e));
+	}
+	return -log10(1.0 - 1.0 / (1.0 + e));
+}
+
+/**
+ * FUNCTION NAME: deadline
+ *
+ * DESCRIPTION: First tick at which phi reaches threshold if no heartbeat comes
+ * 				before, at most PHI_PAUSE plus PHI_MAX_WAIT mean intervals after
+ * 				the last one.
+ * 				-1 without enough samples.
+ */
+long ArrivalWindow::deadline(double threshold) {
+	if ( count < PHI_MIN_SAMPLES ) {
+		return -1;
+	}
+	long limit = last + PHI_PAUSE + max(1L, PHI_MAX_WAIT * sum / count);
+	long t = last + 1;
+	while ( t < limit && phi(t) < threshold ) {
+		t++;
+	}
+	return t;
+}
@@ -0,0 +1,54 @@
+/**********************************
+ * FILE NAME: ArrivalWindow.h
+ *
+ * DESCRIPTION: Header file of ArrivalWindow class
+ **********************************/
+
+#ifndef _ARRIVALWINDOW_H_
+#define _ARRIVALWINDOW_H_
+
+#include "stdincludes.h"
+
+/*
+ * Macros
+ */
+// inter-arrival times kept per member
+#define PHI_WINDOW 16
+// fewer samples than this and phi is not trusted yet
+#define PHI_MIN_SAMPLES 3
+// lower bound of the standard deviation, in ticks, so that a perfectly regular
+// member does not get suspected one tick after it is late
+#define PHI_MIN_STDDEV 1.0
+// ticks of silence past the mean interval that are not suspicious in
+// themselves, e.g. while gossip routes around members that just failed
+#define PHI_PAUSE 3
+// never wait longer than this many mean intervals for a deadline
+#define PHI_MAX_WAIT 64
+
+/**
+ * CLASS NAME: ArrivalWindow
+ *
+ * DESCRIPTION: Phi-accrual failure detection of one member. Keeps the last
+ * 				PHI_WINDOW inter-arrival times of its heartbeats in a ring,
+ * 				and from their mean and standard deviation the suspicion
+ * 				level phi = -log10(P(the next heartbeat comes later still)),
+ * 				the expected interval being the mean plus PHI_PAUSE.
+ */
+class ArrivalWindow {
+private:
+	int samples[PHI_WINDOW];
+	int count;
+	int next;
+	long sum;
+	long sumSq;
+	long last;
+public:
+	ArrivalWindow();
+	virtual ~ArrivalWindow() {}
+	void arrival(long now);
+	int size();
+	double phi(long now);
+	long deadline(double threshold);
+};
+
+#endif /* _ARRIVALWINDOW_H_ */
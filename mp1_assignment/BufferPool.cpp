@@ -0,0 +1,158 @@
+/**********************************
+ * FILE NAME: BufferPool.cpp
+ *
+ * DESCRIPTION: Definition of BufferPool class
+ **********************************/
+
+#include "BufferPool.h"
+
+/**
+ * Constructor
+ */
+BufferPool::BufferPool(): shared(false) {
+	for ( int i = 0; i < POOL_NUM_CLASSES; i++ ) {
+		freelist[i] = NULL;
+	}
+}
+
+/**
+ * Destructor
+ */
+BufferPool::~BufferPool() {
+	for ( unsigned int i = 0; i < slabs.size(); i++ ) {
+		free(slabs[i]);
+	}
+}
+
+/**
+ * FUNCTION NAME: sizeClass
+ *
+ * DESCRIPTION: Return the smallest size class holding size bytes, -1 if none does
+ */
+int BufferPool::sizeClass(int size) {
+	int cls = 0;
+	int classSize = POOL_MIN_CLASS;
+	while ( classSize < size ) {
+		classSize <<= 1;
+		if ( ++cls == POOL_NUM_CLASSES ) {
+			return -1;
+		}
+	}
+	return cls;
+}
+
+/**
+ * FUNCTION NAME: grow
+ *
+ * DESCRIPTION: Allocate a new slab for class cls and put its buffers on the free list
+ */
+void BufferPool::grow(int cls) {
+	int stride = sizeof(pool_hdr) + (POOL_MIN_CLASS << cls);
+	char *slab = (char *) malloc(stride * POOL_SLAB_BUFFERS);
+	slabs.push_back(slab);
+
+	for ( int i = POOL_SLAB_BUFFERS - 1; i >= 0; i-- ) {
+		pool_hdr *hdr = (pool_hdr *)(slab + i * stride);
+		hdr->cls = cls;
+		hdr->next = freelist[cls];
+		freelist[cls] = hdr;
+	}
+}
+
+/**
+ * FUNCTION NAME: take
+ *
+ * DESCRIPTION: Return a buffer of at least size bytes, without locking
+ */
+char *BufferPool::take(int size) {
+	pool_hdr *hdr;
+	int cls = sizeClass(size);
+
+	if ( cls < 0 ) {
+		hdr = (pool_hdr *) malloc(sizeof(pool_hdr) + size);
+		hdr->cls = -1;
+	}
+	else {
+		if ( freelist[cls] == NULL ) {
+			grow(cls);
+		}
+		hdr = freelist[cls];
+		freelist[cls] = hdr->next;
+	}
+	hdr->refs = 1;
+	hdr->next = NULL;
+	return (char *)(hdr + 1);
+}
+
+/**
+ * FUNCTION NAME: give
+ *
+ * DESCRIPTION: Drop one reference to a buffer returned by alloc, giving it
+ * 				back to the pool when it was the last one, without locking
+ */
+void BufferPool::give(char *buf) {
+	if ( buf == NULL ) {
+		return;
+	}
+	pool_hdr *hdr = (pool_hdr *)buf - 1;
+	if ( --hdr->refs > 0 ) {
+		return;
+	}
+	if ( hdr->cls < 0 ) {
+		free(hdr);
+		return;
+	}
+	hdr->next = freelist[hdr->cls];
+	freelist[hdr->cls] = hdr;
+}
+
+/**
+ * FUNCTION NAME: share
+ *
+ * DESCRIPTION: From now on, serialize the calls so that several threads can use the pool
+ */
+void BufferPool::share() {
+	shared = true;
+}
+
+/**
+ * FUNCTION NAME: alloc
+ *
+ * DESCRIPTION: Return a buffer of at least size bytes
+ */
+char *BufferPool::alloc(int size) {
+	if ( shared ) {
+		lock_guard<mutex> hold(lock);
+		return take(size);
+	}
+	return take(size);
+}
+
+/**
+ * FUNCTION NAME: retain
+ *
+ * DESCRIPTION: Add n references to a buffer returned by alloc
+ */
+void BufferPool::retain(char *buf, int n) {
+	if ( shared ) {
+		lock_guard<mutex> hold(lock);
+		((pool_hdr *)buf - 1)->refs += n;
+		return;
+	}
+	((pool_hdr *)buf - 1)->refs += n;
+}
+
+/**
+ * FUNCTION NAME: release
+ *
+ * DESCRIPTION: Drop one reference to a buffer returned by alloc,
+ * 				giving it back to the pool when it was the last one
+ */
+void BufferPool::release(char *buf) {
+	if ( shared ) {
+		lock_guard<mutex> hold(lock);
+		give(buf);
+		return;
+	}
+	give(buf);
+}
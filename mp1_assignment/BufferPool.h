@@ -0,0 +1,66 @@
+/**********************************
+ * FILE NAME: BufferPool.h
+ *
+ * DESCRIPTION: Header file of BufferPool class
+ **********************************/
+
+#ifndef _BUFFERPOOL_H_
+#define _BUFFERPOOL_H_
+
+#include "stdincludes.h"
+
+/*
+ * Macros
+ */
+// smallest size class, in bytes; each following class doubles
+#define POOL_MIN_CLASS 64
+// number of size classes (64 B .. 8 KB)
+#define POOL_NUM_CLASSES 8
+// number of buffers carved out of one slab
+#define POOL_SLAB_BUFFERS 64
+
+/**
+ * Struct Name: pool_hdr
+ *
+ * DESCRIPTION: Header placed in front of every pooled buffer
+ */
+typedef struct pool_hdr {
+	// size class of the buffer, -1 if it was too large for the slabs
+	int cls;
+	// number of outstanding references; the buffer is freed when it drops to 0
+	int refs;
+	// next free buffer of the same class
+	struct pool_hdr *next;
+}pool_hdr;
+
+/**
+ * CLASS NAME: BufferPool
+ *
+ * DESCRIPTION: Size-classed slab allocator for message payloads.
+ * 				A payload is written once into a pooled buffer, passed by
+ * 				pointer from sender to receiver and released after use.
+ * 				Buffers are reference counted so that one payload can be
+ * 				shared by several receivers. Once shared, the pool may be
+ * 				used from several threads at a time.
+ */
+class BufferPool {
+private:
+	pool_hdr *freelist[POOL_NUM_CLASSES];
+	vector<char *> slabs;
+	// whether calls are serialized on lock
+	bool shared;
+	mutex lock;
+	int sizeClass(int size);
+	void grow(int cls);
+	char *take(int size);
+	void give(char *buf);
+public:
+	BufferPool();
+	virtual ~BufferPool();
+	void share();
+	char *alloc(int size);
+	void retain(char *buf, int n);
+	void release(char *buf);
+};
+
+#endif /* _BUFFERPOOL_H_ */
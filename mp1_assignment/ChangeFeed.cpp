@@ -0,0 +1,87 @@
+/**********************************
+ * FILE NAME: ChangeFeed.cpp
+ *
+ * DESCRIPTION: Definition of ChangeFeed class
+ **********************************/
+
+#include "ChangeFeed.h"
+
+/**
+ * Constructor
+ */
+ChangeFeed::ChangeFeed(): head(0), count(0), nextHandle(1) {}
+
+/**
+ * FUNCTION NAME: subscribe
+ *
+ * DESCRIPTION: Register callback to receive every later batch of changes.
+ * 				Returns the handle to unsubscribe with.
+ */
+int ChangeFeed::subscribe(ChangeCallback callback, void *env) {
+	change_listener listener;
+	listener.handle = nextHandle++;
+	listener.callback = callback;
+	listener.env = env;
+	listeners.push_back(listener);
+	return listener.handle;
+}
+
+/**
+ * FUNCTION NAME: unsubscribe
+ *
+ * DESCRIPTION: Stop delivering changes to the listener of handle
+ */
+void ChangeFeed::unsubscribe(int handle) {
+	for ( unsigned int i = 0; i < listeners.size(); i++ ) {
+		if ( listeners[i].handle == handle ) {
+			listeners.erase(listeners.begin() + i);
+			return;
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: record
+ *
+ * DESCRIPTION: Buffer one change. A full ring is flushed first.
+ */
+void ChangeFeed::record(int type, int id, short port, long tick) {
+	if ( listeners.empty() ) {
+		return;
+	}
+	if ( count == CHANGE_RING ) {
+		flush();
+	}
+	MemberChange &change = ring[(head + count) % CHANGE_RING];
+	change.type = type;
+	change.id = id;
+	change.port = port;
+	change.tick = tick;
+	count++;
+}
+
+/**
+ * FUNCTION NAME: flush
+ *
+ * DESCRIPTION: Hand the buffered changes to every listener, oldest first. A batch
+ * 				that wraps around the ring goes out as two calls.
+ */
+void ChangeFeed::flush() {
+	while ( count > 0 ) {
+		int span = min(count, CHANGE_RING - head);
+		for ( unsigned int i = 0; i < listeners.size(); i++ ) {
+			listeners[i].callback(listeners[i].env, ring + head, span);
+		}
+		head = (head + span) % CHANGE_RING;
+		count -= span;
+	}
+}
+
+/**
+ * FUNCTION NAME: pending
+ *
+ * DESCRIPTION: Return the number of buffered changes
+ */
+int ChangeFeed::pending() {
+	return count;
+}
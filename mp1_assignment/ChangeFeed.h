@@ -0,0 +1,89 @@
+/**********************************
+ * FILE NAME: ChangeFeed.h
+ *
+ * DESCRIPTION: Header file of ChangeFeed class
+ **********************************/
+
+#ifndef _CHANGEFEED_H_
+#define _CHANGEFEED_H_
+
+#include "stdincludes.h"
+
+/*
+ * Macros
+ */
+// changes buffered before listeners must be called, even within a tick
+#define CHANGE_RING 256
+
+/**
+ * Membership change types
+ */
+enum ChangeTypes{
+    // the member was added to the list
+    JOIN_CHANGE,
+    // the member is suspected of having failed
+    SUSPECT_CHANGE,
+    // the member was removed as failed
+    FAIL_CHANGE,
+    // the member was removed as it left the group
+    LEAVE_CHANGE,
+    // the member was dropped to keep the list bounded (REGIONS); it is still alive
+    EVICT_CHANGE,
+    DUMMYLASTCHANGETYPE
+};
+
+/**
+ * Struct Name: MemberChange
+ *
+ * DESCRIPTION: One change of the membership list, and the tick it happened at
+ */
+typedef struct MemberChange {
+	int type;
+	int id;
+	short port;
+	long tick;
+}MemberChange;
+
+/**
+ * Listener callback: env as given to subscribe, and a batch of changes in order
+ */
+typedef void (*ChangeCallback)(void *env, const MemberChange *changes, int count);
+
+/**
+ * Struct Name: change_listener
+ *
+ * DESCRIPTION: A subscribed callback and its handle
+ */
+typedef struct change_listener {
+	int handle;
+	ChangeCallback callback;
+	void *env;
+}change_listener;
+
+/**
+ * CLASS NAME: ChangeFeed
+ *
+ * DESCRIPTION: Delivers the membership changes of a node to its listeners in
+ * 				batches. Changes are buffered in a fixed ring of CHANGE_RING
+ * 				entries and handed over by flush, once per tick, or earlier
+ * 				when the ring fills up. Without listeners nothing is buffered.
+ */
+class ChangeFeed {
+private:
+	MemberChange ring[CHANGE_RING];
+	// oldest buffered change and number of buffered changes
+	int head;
+	int count;
+	vector<change_listener> listeners;
+	int nextHandle;
+public:
+	ChangeFeed();
+	virtual ~ChangeFeed() {}
+	int subscribe(ChangeCallback callback, void *env);
+	void unsubscribe(int handle);
+	void record(int type, int id, short port, long tick);
+	void flush();
+	int pending();
+};
+
+#endif /* _CHANGEFEED_H_ */
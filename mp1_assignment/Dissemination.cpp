@@ -0,0 +1,59 @@
+/**********************************
+ * FILE NAME: Dissemination.cpp
+ *
+ * DESCRIPTION: Definition of Dissemination class
+ **********************************/
+
+#include "Dissemination.h"
+
+/**
+ * FUNCTION NAME: add
+ *
+ * DESCRIPTION: Queue event, replacing any queued event about the same member.
+ * 				The event starts with no transmissions.
+ */
+void Dissemination::add(const MemberEvent &event) {
+	pending_event pending;
+	pending.event = event;
+	pending.sent = 0;
+	for ( unsigned int i = 0; i < events.size(); i++ ) {
+		if ( events[i].event.id == event.id ) {
+			events[i] = pending;
+			return;
+		}
+	}
+	events.push_back(pending);
+}
+
+/**
+ * FUNCTION NAME: select
+ *
+ * DESCRIPTION: Copy up to max of the events sent least often to out and count
+ * 				one transmission for each. Events sent limit times are dropped.
+ * 				Returns the number of events copied.
+ */
+int Dissemination::select(int max, int limit, MemberEvent *out) {
+	int n = min(max, (int)events.size());
+	partial_sort(events.begin(), events.begin() + n, events.end(),
+			[](const pending_event &a, const pending_event &b){ return a.sent < b.sent; });
+	for ( int i = 0; i < n; i++ ) {
+		out[i] = events[i].event;
+		events[i].sent++;
+	}
+	for ( int i = n - 1; i >= 0; i-- ) {
+		if ( events[i].sent >= limit ) {
+			events[i] = events.back();
+			events.pop_back();
+		}
+	}
+	return n;
+}
+
+/**
+ * FUNCTION NAME: size
+ *
+ * DESCRIPTION: Return the number of queued events
+ */
+int Dissemination::size() {
+	return (int)events.size();
+}
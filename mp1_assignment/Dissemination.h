@@ -0,0 +1,68 @@
+/**********************************
+ * FILE NAME: Dissemination.h
+ *
+ * DESCRIPTION: Header file of Dissemination class
+ **********************************/
+
+#ifndef _DISSEMINATION_H_
+#define _DISSEMINATION_H_
+
+#include "stdincludes.h"
+
+/**
+ * Membership event types
+ */
+enum EventTypes{
+    // the member is alive at this incarnation; about an unknown member it is a join
+    ALIVE_EVENT,
+    // the member is suspected at this incarnation
+    SUSPECT_EVENT,
+    // the member was confirmed failed
+    FAILED_EVENT,
+    // the member left the group
+    LEAVE_EVENT,
+    DUMMYLASTEVENTTYPE
+};
+
+/**
+ * Struct Name: MemberEvent
+ *
+ * DESCRIPTION: One membership change, as piggybacked on protocol messages
+ */
+typedef struct MemberEvent {
+	int type;
+	int id;
+	short port;
+	long incarnation;
+}MemberEvent;
+
+/**
+ * Struct Name: pending_event
+ *
+ * DESCRIPTION: An event waiting in the buffer, and how often it went out
+ */
+typedef struct pending_event {
+	MemberEvent event;
+	int sent;
+}pending_event;
+
+/**
+ * CLASS NAME: Dissemination
+ *
+ * DESCRIPTION: Infection-style dissemination buffer. Holds the latest event
+ * 				about each member; every outgoing message takes the few
+ * 				events sent least often so far, and an event is dropped once
+ * 				it has gone out the given number of times.
+ */
+class Dissemination {
+private:
+	vector<pending_event> events;
+public:
+	Dissemination() {}
+	virtual ~Dissemination() {}
+	void add(const MemberEvent &event);
+	int select(int max, int limit, MemberEvent *out);
+	int size();
+};
+
+#endif /* _DISSEMINATION_H_ */
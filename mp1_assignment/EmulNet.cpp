@@ -12,17 +12,15 @@
 EmulNet::EmulNet(Params *p)
 {
 	//trace.funcEntry("EmulNet::EmulNet");
-	int i,j;
 	par = p;
 	emulnet.setNextId(1);
 	emulnet.settCurrBuffSize(0);
 	enInited=0;
-	for ( i = 0; i < MAX_NODES; i++ ) {
-		for ( j = 0; j < MAX_TIME; j++ ) {
-			sent_msgs[i][j] = 0;
-			recv_msgs[i][j] = 0;
-		}
-	}
+	// node ids run from 1 to EN_GPSZ
+	sent_msgs.resize(par->EN_GPSZ + 1);
+	recv_msgs.resize(par->EN_GPSZ + 1);
+	sent_bytes = 0;
+	recv_bytes = 0;
 	//trace.funcExit("EmulNet::EmulNet", SUCCESS);
 }
 
@@ -30,15 +28,12 @@ EmulNet::EmulNet(Params *p)
  * Copy constructor
  */
 EmulNet::EmulNet(EmulNet &anotherEmulNet) {
-	int i, j;
 	this->par = anotherEmulNet.par;
 	this->enInited = anotherEmulNet.enInited;
-	for ( i = 0; i < MAX_NODES; i++ ) {
-		for ( j = 0; j < MAX_TIME; j++ ) {
-			this->sent_msgs[i][j] = anotherEmulNet.sent_msgs[i][j];
-			this->recv_msgs[i][j] = anotherEmulNet.recv_msgs[i][j];
-		}
-	}
+	this->sent_msgs = anotherEmulNet.sent_msgs;
+	this->recv_msgs = anotherEmulNet.recv_msgs;
+	this->sent_bytes = anotherEmulNet.sent_bytes;
+	this->recv_bytes = anotherEmulNet.recv_bytes;
 	this->emulnet = anotherEmulNet.emulnet;
 }
 
@@ -46,15 +41,12 @@ EmulNet::EmulNet(EmulNet &anotherEmulNet) {
  * Assignment operator overloading
  */
 EmulNet& EmulNet::operator =(EmulNet &anotherEmulNet) {
-	int i, j;
 	this->par = anotherEmulNet.par;
 	this->enInited = anotherEmulNet.enInited;
-	for ( i = 0; i < MAX_NODES; i++ ) {
-		for ( j = 0; j < MAX_TIME; j++ ) {
-			this->sent_msgs[i][j] = anotherEmulNet.sent_msgs[i][j];
-			this->recv_msgs[i][j] = anotherEmulNet.recv_msgs[i][j];
-		}
-	}
+	this->sent_msgs = anotherEmulNet.sent_msgs;
+	this->recv_msgs = anotherEmulNet.recv_msgs;
+	this->sent_bytes = anotherEmulNet.sent_bytes;
+	this->recv_bytes = anotherEmulNet.recv_bytes;
 	this->emulnet = anotherEmulNet.emulnet;
 	return *this;
 }
@@ -71,22 +63,43 @@ EmulNet::~EmulNet() {}
  */
 void *EmulNet::ENinit(Address *myaddr, short port) {
 	// Initialize data structures for this member
-	*(int *)(myaddr->addr) = emulnet.nextid++;
+	int id = emulnet.nextid++;
+	*(int *)(myaddr->addr) = id;
     *(short *)(&myaddr->addr[4]) = 0;
+	emulnet.getMailbox(id);
 	return myaddr;
 }
 
 /**
- * FUNCTION NAME: ENsend
+ * FUNCTION NAME: ENalloc
  *
- * DESCRIPTION: EmulNet send function
- * myaddr: the address this message coming from
- * toaddr: the destination address
+ * DESCRIPTION: Allocate a pooled payload buffer of at least size bytes,
+ * 				to be filled in and handed to ENsendbuf
+ */
+char *EmulNet::ENalloc(int size) {
+	return pool.alloc(size);
+}
+
+/**
+ * FUNCTION NAME: ENfree
+ *
+ * DESCRIPTION: Give a payload buffer back to the pool once the receiver is done with it
+ */
+void EmulNet::ENfree(char *buf) {
+	pool.release(buf);
+}
+
+/**
+ * FUNCTION NAME: ENenqueue
+ *
+ * DESCRIPTION: Put one message carrying buf into the mailbox of toaddr, unless the
+ * 				network is full, the message too large or it gets dropped.
+ * 				Does not touch the references held on buf.
  * RETURNS:
- * size
+ * size, 0 if the message was not enqueued
  */
-int EmulNet::ENsend(Address *myaddr, Address *toaddr, char *data, int size) {
-	en_msg *em;
+int EmulNet::ENenqueue(Address *myaddr, Address *toaddr, char *buf, int size) {
+	en_msg em;
 	static char temp[2048];
 	int sendmsg = rand() % 100;
 
@@ -94,30 +107,97 @@ int EmulNet::ENsend(Address *myaddr, Address *toaddr, char *data, int size) {
 		return 0;
 	}
 
-	em = (en_msg *)malloc(sizeof(en_msg) + size);
-	em->size = size;
-
-	memcpy(&(em->from.addr), &(myaddr->addr), sizeof(em->from.addr));
-	memcpy(&(em->to.addr), &(toaddr->addr), sizeof(em->from.addr));
-	memcpy(em + 1, data, size);
+	em.size = size;
+	em.data = buf;
+	memcpy(&(em.from.addr), &(myaddr->addr), sizeof(em.from.addr));
+	memcpy(&(em.to.addr), &(toaddr->addr), sizeof(em.to.addr));
 
-	emulnet.buff[emulnet.currbuffsize++] = em;
+	emulnet.getMailbox(*(int *)(toaddr->addr)).push_back(em);
+	emulnet.currbuffsize++;
 
-	int src = *(int *)(myaddr->addr);
-	int time = par->getcurrtime();
-
-	assert(src <= MAX_NODES);
-	assert(time < MAX_TIME);
-
-	sent_msgs[src][time]++;
+	countMsg(sent_msgs, *(int *)(myaddr->addr));
+	sent_bytes += size;
 
 	#ifdef DEBUGLOG
-		sprintf(temp, "Sending 4+%d B msg type %d to %d.%d.%d.%d:%d ", size-4, *(int *)data, toaddr->addr[0], toaddr->addr[1], toaddr->addr[2], toaddr->addr[3], *(short *)&toaddr->addr[4]);
+		sprintf(temp, "Sending 4+%d B msg type %d to %d.%d.%d.%d:%d ", size-4, *(int *)buf, toaddr->addr[0], toaddr->addr[1], toaddr->addr[2], toaddr->addr[3], *(short *)&toaddr->addr[4]);
 	#endif
 
 	return size;
 }
 
+/**
+ * FUNCTION NAME: ENsendbuf
+ *
+ * DESCRIPTION: EmulNet send function for a payload already in a pooled buffer.
+ * 				The buffer is handed to the receiver as is; the network owns it
+ * 				from here on, including when the message is dropped. Called
+ * 				from a pool worker, the send is only made at the next ENflush.
+ * myaddr: the address this message coming from
+ * toaddr: the destination address
+ * RETURNS:
+ * size
+ */
+int EmulNet::ENsendbuf(Address *myaddr, Address *toaddr, char *buf, int size) {
+	if ( outbox() != NULL ) {
+		defer(SEND_ONE, myaddr, toaddr, buf, size);
+		return size;
+	}
+	int ret = ENenqueue(myaddr, toaddr, buf, size);
+	if ( ret == 0 ) {
+		pool.release(buf);
+	}
+	return ret;
+}
+
+/**
+ * FUNCTION NAME: ENmulticast
+ *
+ * DESCRIPTION: Send one pooled payload to the count addresses in toaddrs. The payload is
+ * 				shared by all the receivers, each holding one reference to it.
+ * 				Drops and message counts apply per destination, as with ENsend.
+ * 				The network owns buf from here on.
+ * RETURNS:
+ * number of destinations the message was sent to, all of them when the send is
+ * deferred to ENflush
+ */
+int EmulNet::ENmulticast(Address *myaddr, Address *toaddrs, int count, char *buf, int size) {
+	int sent = 0;
+
+	if ( outbox() != NULL ) {
+		for ( int i = 0; i < count; i++ ) {
+			defer(SEND_SHARED, myaddr, &toaddrs[i], buf, size);
+		}
+		defer(SEND_RELEASE, myaddr, myaddr, buf, size);
+		return count;
+	}
+
+	for ( int i = 0; i < count; i++ ) {
+		if ( ENenqueue(myaddr, &toaddrs[i], buf, size) ) {
+			pool.retain(buf, 1);
+			sent++;
+		}
+	}
+	// drop the sender's reference
+	pool.release(buf);
+
+	return sent;
+}
+
+/**
+ * FUNCTION NAME: ENsend
+ *
+ * DESCRIPTION: EmulNet send function
+ * myaddr: the address this message coming from
+ * toaddr: the destination address
+ * RETURNS:
+ * size
+ */
+int EmulNet::ENsend(Address *myaddr, Address *toaddr, char *data, int size) {
+	char *buf = pool.alloc(size);
+	memcpy(buf, data, size);
+	return ENsendbuf(myaddr, toaddr, buf, size);
+}
+
 /**
  * FUNCTION NAME: ENsend
  *
@@ -127,17 +207,15 @@ int EmulNet::ENsend(Address *myaddr, Address *toaddr, char *data, int size) {
  * size
  */
 int EmulNet::ENsend(Address *myaddr, Address *toaddr, string data) {
-	char * str = (char *) malloc(data.length() * sizeof(char));
-	memcpy(str, data.c_str(), data.size());
-	int ret = this->ENsend(myaddr, toaddr, str, (data.length() * sizeof(char)));
-	free(str);
-	return ret;
+	return this->ENsend(myaddr, toaddr, (char *)data.c_str(), (data.length() * sizeof(char)));
 }
 
 /**
  * FUNCTION NAME: ENrecv
  *
- * DESCRIPTION: EmulNet receive function
+ * DESCRIPTION: EmulNet receive function. Payloads are enqueued by reference;
+ * 				the receiver gives each one back with ENfree after handling it.
+ * 				Pool workers may receive at the same time, each for its own nodes.
  *
  * RETURN:
  * 0
@@ -145,32 +223,27 @@ int EmulNet::ENsend(Address *myaddr, Address *toaddr, string data) {
 int EmulNet::ENrecv(Address *myaddr, int (* enq)(void *, char *, int), struct timeval *t, int times, void *queue){
 	// times is always assumed to be 1
 	int i;
-	char* tmp;
-	int sz;
-	en_msg *emsg;
-
-	for( i = emulnet.currbuffsize - 1; i >= 0; i-- ) {
-		emsg = emulnet.buff[i];
-
-		if ( 0 == strcmp(emsg->to.addr, myaddr->addr) ) {
-			sz = emsg->size;
-			tmp = (char *) malloc(sz * sizeof(char));
-			memcpy(tmp, (char *)(emsg+1), sz);
-
-			emulnet.buff[i] = emulnet.buff[emulnet.currbuffsize-1];
-			emulnet.currbuffsize--;
+	vector<en_msg> &box = emulnet.getMailbox(*(int *)(myaddr->addr));
 
-			(*enq)(queue, (char *)tmp, sz);
+	// Every message in the mailbox is for this node; take them from the back,
+	// which is the swap-with-last removal on a buffer holding only our messages
+	for( i = (int)box.size() - 1; i >= 0; i-- ) {
+		en_msg emsg = box[i];
 
-			free(emsg);
+		box.pop_back();
 
-			int dst = *(int *)(myaddr->addr);
-			int time = par->getcurrtime();
+		(*enq)(queue, emsg.data, emsg.size);
 
-			assert(dst <= MAX_NODES);
-			assert(time < MAX_TIME);
-
-			recv_msgs[dst][time]++;
+		countMsg(recv_msgs, *(int *)(myaddr->addr));
+		// the totals are shared by all nodes; workers add theirs up at ENflush
+		en_outbox *mine = outbox();
+		if ( mine != NULL ) {
+			mine->received++;
+			mine->recvBytes += emsg.size;
+		}
+		else {
+			emulnet.currbuffsize--;
+			recv_bytes += emsg.size;
 		}
 	}
 
@@ -186,36 +259,142 @@ int EmulNet::ENcleanup() {
 	emulnet.nextid=0;
 	int i, j;
 	int sent_total, recv_total;
+	long all_sent = 0, all_recv = 0;
 
 	FILE* file = fopen("msgcount.log", "w+");
 
-	while(emulnet.currbuffsize > 0) {
-		free(emulnet.buff[--emulnet.currbuffsize]);
+	for ( i = 0; i < (int)emulnet.mailbox.size(); i++ ) {
+		for ( j = 0; j < (int)emulnet.mailbox[i].size(); j++ ) {
+			pool.release(emulnet.mailbox[i][j].data);
+		}
+		emulnet.mailbox[i].clear();
 	}
+	emulnet.currbuffsize = 0;
 
 	for ( i = 1; i <= par->EN_GPSZ; i++ ) {
 		fprintf(file, "node %3d ", i);
 		sent_total = 0;
 		recv_total = 0;
 
+		MsgCounter &sent = sent_msgs[i];
+		MsgCounter &recv = recv_msgs[i];
+
 		for (j = 0; j < par->getcurrtime(); j++) {
 
-			sent_total += sent_msgs[i][j];
-			recv_total += recv_msgs[i][j];
+			sent_total += sent.get(j);
+			recv_total += recv.get(j);
 			if (i != 67) {
-				fprintf(file, " (%4d, %4d)", sent_msgs[i][j], recv_msgs[i][j]);
+				fprintf(file, " (%4d, %4d)", sent.get(j), recv.get(j));
 				if (j % 10 == 9) {
 					fprintf(file, "\n         ");
 				}
 			}
 			else {
-				fprintf(file, "special %4d %4d %4d\n", j, sent_msgs[i][j], recv_msgs[i][j]);
+				fprintf(file, "special %4d %4d %4d\n", j, sent.get(j), recv.get(j));
 			}
 		}
 		fprintf(file, "\n");
 		fprintf(file, "node %3d sent_total %6u  recv_total %6u\n\n", i, sent_total, recv_total);
+		all_sent += sent_total;
+		all_recv += recv_total;
 	}
 
+	// run-wide totals, to compare dissemination modes on the same scenario
+	fprintf(file, "all sent_total %ld  recv_total %ld  sent_bytes %ld  recv_bytes %ld\n", all_sent, all_recv, sent_bytes, recv_bytes);
+
 	fclose(file);
 	return 0;
 }
+
+/**
+ * FUNCTION NAME: countMsg
+ *
+ * DESCRIPTION: Count one message for node id at the current time
+ */
+void EmulNet::countMsg(vector<MsgCounter> &counters, int id) {
+	if ( id >= (int)counters.size() ) {
+		counters.resize(id + 1);
+	}
+	counters[id].add(par->getcurrtime());
+}
+
+/**
+ * FUNCTION NAME: ENthreads
+ *
+ * DESCRIPTION: Let count pool workers use the network at the same time. Their
+ * 				sends wait in one outbox per worker until ENflush, and the
+ * 				buffer pool is locked from now on.
+ */
+void EmulNet::ENthreads(int count) {
+	outboxes.resize(count);
+	for ( int i = 0; i < count; i++ ) {
+		outboxes[i].received = 0;
+		outboxes[i].recvBytes = 0;
+	}
+	pool.share();
+}
+
+/**
+ * FUNCTION NAME: ENflush
+ *
+ * DESCRIPTION: Carry out what the workers did since the last call, worker by worker.
+ * 				Called between pool runs only. Workers get contiguous blocks of
+ * 				nodes in order, so the sends are made in the order a single
+ * 				thread would have made them.
+ */
+void EmulNet::ENflush() {
+	unsigned int i, j;
+	for ( i = 0; i < outboxes.size(); i++ ) {
+		emulnet.currbuffsize -= outboxes[i].received;
+		recv_bytes += outboxes[i].recvBytes;
+		outboxes[i].received = 0;
+		outboxes[i].recvBytes = 0;
+	}
+	for ( i = 0; i < outboxes.size(); i++ ) {
+		vector<en_send> &sends = outboxes[i].sends;
+		for ( j = 0; j < sends.size(); j++ ) {
+			en_send &send = sends[j];
+			if ( send.kind == SEND_RELEASE ) {
+				pool.release(send.buf);
+			}
+			else if ( ENenqueue(&send.from, &send.to, send.buf, send.size) ) {
+				if ( send.kind == SEND_SHARED ) {
+					pool.retain(send.buf, 1);
+				}
+			}
+			else if ( send.kind == SEND_ONE ) {
+				pool.release(send.buf);
+			}
+		}
+		sends.clear();
+	}
+}
+
+/**
+ * FUNCTION NAME: outbox
+ *
+ * DESCRIPTION: Return the outbox of the calling pool worker, NULL when the call
+ * 				is not from a worker and takes effect at once
+ */
+en_outbox *EmulNet::outbox() {
+	int self = ThreadPool::self();
+	if ( self < 0 || self >= (int)outboxes.size() ) {
+		return NULL;
+	}
+	return &outboxes[self];
+}
+
+/**
+ * FUNCTION NAME: defer
+ *
+ * DESCRIPTION: Queue a send in the outbox of the calling worker
+ */
+void EmulNet::defer(int kind, Address *myaddr, Address *toaddr, char *buf, int size) {
+	en_send send;
+	send.kind = kind;
+	send.from = *myaddr;
+	send.to = *toaddr;
+	send.buf = buf;
+	send.size = size;
+	outbox()->sends.push_back(send);
+}
@@ -7,13 +7,13 @@
 #ifndef _EMULNET_H_
 #define _EMULNET_H_
 
-#define MAX_NODES 1000
-#define MAX_TIME 3600
 #define ENBUFFSIZE 30000
 
 #include "stdincludes.h"
 #include "Params.h"
 #include "Member.h"
+#include "BufferPool.h"
+#include "ThreadPool.h"
 
 using namespace std;
 
@@ -27,27 +27,68 @@ typedef struct en_msg {
 	Address from;
 	// Destination node
 	Address to;
+	// Payload, a pooled buffer owned by the message until it is received
+	char *data;
 }en_msg;
 
+/**
+ * Kinds of deferred sends
+ */
+enum SendKinds{
+	// one message, whose buffer is released if it is not enqueued
+	SEND_ONE,
+	// one destination of a multicast, which holds a reference once enqueued
+	SEND_SHARED,
+	// the end of a multicast: drop the sender's reference
+	SEND_RELEASE
+};
+
+/**
+ * Struct Name: en_send
+ *
+ * DESCRIPTION: Send made by a pool worker, carried out at the next ENflush
+ */
+typedef struct en_send {
+	int kind;
+	Address from;
+	Address to;
+	char *buf;
+	int size;
+}en_send;
+
+/**
+ * Struct Name: en_outbox
+ *
+ * DESCRIPTION: What a pool worker did to the network since the last ENflush
+ */
+typedef struct en_outbox {
+	// sends, in the order they were made
+	vector<en_send> sends;
+	// messages and payload bytes taken out of the mailboxes
+	int received;
+	long recvBytes;
+}en_outbox;
+
 /**
  * Class Name: EM
+ *
+ * DESCRIPTION: In-flight messages, kept in one mailbox per destination node id
+ * 				so that a receive only touches the receiver's own messages
  */
 class EM {
 public:
 	int nextid;
+	// total number of messages in flight, across all mailboxes
 	int currbuffsize;
 	int firsteltindex;
-	en_msg* buff[ENBUFFSIZE];
+	// mailbox[id] holds the messages waiting for node id
+	vector< vector<en_msg> > mailbox;
 	EM() {}
 	EM& operator = (EM &anotherEM) {
 		this->nextid = anotherEM.getNextId();
 		this->currbuffsize = anotherEM.getCurrBuffSize();
 		this->firsteltindex = anotherEM.getFirstEltIndex();
-		int i = this->currbuffsize;
-		while (i > 0) {
-			this->buff[i] = anotherEM.buff[i];
-			i--;
-		}
+		this->mailbox = anotherEM.mailbox;
 		return *this;
 	}
 	int getNextId() {
@@ -68,9 +109,49 @@ public:
 	void setFirstEltIndex(int firsteltindex) {
 		this->firsteltindex = firsteltindex;
 	}
+	// Returns the mailbox of node id, creating it if needed
+	vector<en_msg>& getMailbox(int id) {
+		if ( id >= (int)mailbox.size() ) {
+			mailbox.resize(id + 1);
+		}
+		return mailbox[id];
+	}
 	virtual ~EM() {}
 };
 
+/**
+ * Class Name: MsgCounter
+ *
+ * DESCRIPTION: Per-tick message counts of a single node. Only the span of ticks
+ * 				between the node's first and last counted message is stored.
+ */
+class MsgCounter {
+public:
+	// first tick held in count, -1 while nothing has been counted
+	int first;
+	vector<int> count;
+	MsgCounter(): first(-1) {}
+	void add(int time) {
+		if ( first == -1 ) {
+			first = time;
+		}
+		if ( time < first ) {
+			count.insert(count.begin(), first - time, 0);
+			first = time;
+		}
+		if ( time - first >= (int)count.size() ) {
+			count.resize(time - first + 1, 0);
+		}
+		count[time - first]++;
+	}
+	int get(int time) {
+		if ( first == -1 || time < first || time - first >= (int)count.size() ) {
+			return 0;
+		}
+		return count[time - first];
+	}
+};
+
 /**
  * CLASS NAME: EmulNet
  *
@@ -80,10 +161,20 @@ class EmulNet
 { 	
 private:
 	Params* par;
-	int sent_msgs[MAX_NODES + 1][MAX_TIME];
-	int recv_msgs[MAX_NODES + 1][MAX_TIME];
+	// sent_msgs[id] / recv_msgs[id]: per-tick message counts of node id
+	vector<MsgCounter> sent_msgs;
+	vector<MsgCounter> recv_msgs;
+	// payload bytes sent and received over the whole run
+	long sent_bytes;
+	long recv_bytes;
 	int enInited;
 	EM emulnet;
+	// Payload buffers of the messages in flight
+	BufferPool pool;
+	// with worker threads, one outbox per worker
+	vector<en_outbox> outboxes;
+	en_outbox *outbox();
+	void defer(int kind, Address *myaddr, Address *toaddr, char *buf, int size);
 public:
  	EmulNet(Params *p);
  	EmulNet(EmulNet &anotherEmulNet);
@@ -92,8 +183,17 @@ public:
 	void *ENinit(Address *myaddr, short port);
 	int ENsend(Address *myaddr, Address *toaddr, string data);
 	int ENsend(Address *myaddr, Address *toaddr, char *data, int size);
+	int ENsendbuf(Address *myaddr, Address *toaddr, char *buf, int size);
+	int ENmulticast(Address *myaddr, Address *toaddrs, int count, char *buf, int size);
+	char *ENalloc(int size);
+	void ENfree(char *buf);
 	int ENrecv(Address *myaddr, int (* enq)(void *, char *, int), struct timeval *t, int times, void *queue);
 	int ENcleanup();
+	void ENthreads(int count);
+	void ENflush();
+private:
+	int ENenqueue(Address *myaddr, Address *toaddr, char *buf, int size);
+	void countMsg(vector<MsgCounter> &counters, int id);
 };
 
 #endif /* _EMULNET_H_ */
@@ -0,0 +1,171 @@
+/**********************************
+ * FILE NAME: HashRing.cpp
+ *
+ * DESCRIPTION: Definition of HashRing class
+ **********************************/
+
+#include "HashRing.h"
+
+/**
+ * Points sort by position, and by owner within a position
+ */
+static bool comparePoint(const ring_point &a, const ring_point &b) {
+	return a.position < b.position || (a.position == b.position && a.id < b.id);
+}
+
+/**
+ * Constructor
+ */
+HashRing::HashRing(): members(0) {}
+
+/**
+ * FUNCTION NAME: mix
+ *
+ * DESCRIPTION: Scramble the bits of h, so that nearby inputs land far apart
+ */
+unsigned int HashRing::mix(unsigned int h) {
+	h ^= h >> 16;
+	h *= 0x85ebca6bu;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35u;
+	h ^= h >> 16;
+	return h;
+}
+
+/**
+ * FUNCTION NAME: pointOf
+ *
+ * DESCRIPTION: Return the ring position of virtual node vnode of member id
+ */
+int HashRing::pointOf(int id, int vnode) {
+	return (int)(mix((unsigned int)id * RING_VNODES + vnode) % RING_SIZE);
+}
+
+/**
+ * FUNCTION NAME: keyPosition
+ *
+ * DESCRIPTION: Return the ring position of key (FNV-1a, then mixed)
+ */
+int HashRing::keyPosition(const string &key) {
+	unsigned int h = 2166136261u;
+	for ( unsigned int i = 0; i < key.size(); i++ ) {
+		h = (h ^ (unsigned char)key[i]) * 16777619u;
+	}
+	return (int)(mix(h) % RING_SIZE);
+}
+
+/**
+ * FUNCTION NAME: add
+ *
+ * DESCRIPTION: Put the points of member id on the ring. A member already on
+ * 				the ring is left as it is.
+ */
+void HashRing::add(int id, short port) {
+	if ( contains(id) ) {
+		return;
+	}
+	for ( int v = 0; v < RING_VNODES; v++ ) {
+		ring_point point;
+		point.position = pointOf(id, v);
+		point.id = id;
+		point.port = port;
+		points.insert(upper_bound(points.begin(), points.end(), point, comparePoint), point);
+	}
+	members++;
+}
+
+/**
+ * FUNCTION NAME: remove
+ *
+ * DESCRIPTION: Take the points of member id off the ring, if it is on it
+ */
+void HashRing::remove(int id) {
+	if ( !contains(id) ) {
+		return;
+	}
+	for ( int v = 0; v < RING_VNODES; v++ ) {
+		ring_point point;
+		point.position = pointOf(id, v);
+		point.id = id;
+		vector<ring_point>::iterator it = lower_bound(points.begin(), points.end(), point, comparePoint);
+		if ( it != points.end() && it->position == point.position && it->id == id ) {
+			points.erase(it);
+		}
+	}
+	members--;
+}
+
+/**
+ * FUNCTION NAME: contains
+ *
+ * DESCRIPTION: Return true if member id is on the ring
+ */
+bool HashRing::contains(int id) {
+	ring_point point;
+	point.position = pointOf(id, 0);
+	point.id = id;
+	vector<ring_point>::iterator it = lower_bound(points.begin(), points.end(), point, comparePoint);
+	return it != points.end() && it->position == point.position && it->id == id;
+}
+
+/**
+ * FUNCTION NAME: lookup
+ *
+ * DESCRIPTION: Write the addresses of the up to replicas members that own key
+ * 				to owners, primary first. Returns the number written.
+ */
+int HashRing::lookup(const string &key, int replicas, Address *owners) {
+	return lookupPosition(keyPosition(key), replicas, owners);
+}
+
+/**
+ * FUNCTION NAME: lookupPosition
+ *
+ * DESCRIPTION: Write the addresses of the up to replicas distinct members owning
+ * 				the first points at or clockwise after position to owners.
+ * 				Returns the number written.
+ */
+int HashRing::lookupPosition(int position, int replicas, Address *owners) {
+	int wanted = min(replicas, members);
+	if ( wanted <= 0 ) {
+		return 0;
+	}
+	int n = (int)points.size();
+	int first = (int)(lower_bound(points.begin(), points.end(), position,
+			[](const ring_point &point, int position){ return point.position < position; }) - points.begin());
+	int found = 0;
+	for ( int i = 0; i < n && found < wanted; i++ ) {
+		ring_point &point = points[(first + i) % n];
+		bool seen = false;
+		for ( int j = 0; j < found && !seen; j++ ) {
+			seen = *(int *)(&owners[j].addr) == point.id;
+		}
+		if ( seen ) {
+			continue;
+		}
+		owners[found].init();
+		*(int *)(&owners[found].addr) = point.id;
+		*(short *)(&owners[found].addr[4]) = point.port;
+		found++;
+	}
+	return found;
+}
+
+/**
+ * FUNCTION NAME: clear
+ *
+ * DESCRIPTION: Take every member off the ring
+ */
+void HashRing::clear() {
+	points.clear();
+	members = 0;
+}
+
+/**
+ * FUNCTION NAME: size
+ *
+ * DESCRIPTION: Return the number of members on the ring
+ */
+int HashRing::size() {
+	return members;
+}
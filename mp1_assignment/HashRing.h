@@ -0,0 +1,60 @@
+/**********************************
+ * FILE NAME: HashRing.h
+ *
+ * DESCRIPTION: Header file of HashRing class
+ **********************************/
+
+#ifndef _HASHRING_H_
+#define _HASHRING_H_
+
+#include "stdincludes.h"
+#include "Member.h"
+
+/*
+ * Macros
+ */
+// points each member gets on the ring
+#define RING_VNODES 16
+
+/**
+ * Struct Name: ring_point
+ *
+ * DESCRIPTION: One virtual node: a position in [0, RING_SIZE) owned by a member
+ */
+typedef struct ring_point {
+	int position;
+	int id;
+	short port;
+}ring_point;
+
+/**
+ * CLASS NAME: HashRing
+ *
+ * DESCRIPTION: Consistent-hashing ring over the members. Every member owns
+ * 				RING_VNODES points, and a key belongs to the members owning
+ * 				the first points at or clockwise after its own position.
+ * 				The points are kept sorted by position (then id, as positions
+ * 				may collide in a ring of RING_SIZE), so a lookup is a binary
+ * 				search, O(log N). Adding or removing a member inserts or
+ * 				erases only its own points; nothing is rebuilt.
+ */
+class HashRing {
+private:
+	vector<ring_point> points;
+	int members;
+	static unsigned int mix(unsigned int h);
+	int pointOf(int id, int vnode);
+public:
+	HashRing();
+	virtual ~HashRing() {}
+	static int keyPosition(const string &key);
+	void add(int id, short port);
+	void remove(int id);
+	bool contains(int id);
+	int lookup(const string &key, int replicas, Address *owners);
+	int lookupPosition(int position, int replicas, Address *owners);
+	void clear();
+	int size();
+};
+
+#endif /* _HASHRING_H_ */
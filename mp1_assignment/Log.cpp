@@ -39,14 +39,37 @@ Log::~Log() {}
 /**
  * FUNCTION NAME: LOG
  *
- * DESCRIPTION: Print out to file dbg.log, along with Address of node.
+ * DESCRIPTION: Print out to file dbg.log, along with Address of node. Lines logged
+ * 				from a pool worker are held until flush.
  */
 void Log::LOG(Address *addr, const char * str, ...) {
+	va_list vararglist;
+	char buffer[30000];
+
+	va_start(vararglist, str);
+	vsprintf(buffer, str, vararglist);
+	va_end(vararglist);
+
+	int self = ThreadPool::self();
+	if ( self >= 0 && self < (int)pending.size() ) {
+		log_line line;
+		line.addr = *addr;
+		line.text = buffer;
+		pending[self].push_back(line);
+		return;
+	}
+	write(addr, buffer);
+}
+
+/**
+ * FUNCTION NAME: write
+ *
+ * DESCRIPTION: Write one logged line to its file
+ */
+void Log::write(Address *addr, const char *buffer) {
 
 	static FILE *fp;
 	static FILE *fp2;
-	va_list vararglist;
-	static char buffer[30000];
 	static int numwrites;
 	static char stdstring[30];
 	static char stdstring2[40];
@@ -72,10 +95,6 @@ void Log::LOG(Address *addr, const char * str, ...) {
 
 	sprintf(stdstring, "%d.%d.%d.%d:%d ", addr->addr[0], addr->addr[1], addr->addr[2], addr->addr[3], *(short *)&addr->addr[4]);
 
-	va_start(vararglist, str);
-	vsprintf(buffer, str, vararglist);
-	va_end(vararglist);
-
 	if (!firstTime) {
 		int magicNumber = 0;
 		string magic = MAGIC_NUMBER;
@@ -114,7 +133,7 @@ void Log::LOG(Address *addr, const char * str, ...) {
  * DESCRIPTION: To Log a node add
  */
 void Log::logNodeAdd(Address *thisNode, Address *addedAddr) {
-	static char stdstring[100];
+	char stdstring[100];
 	sprintf(stdstring, "Node %d.%d.%d.%d:%d joined at time %d", addedAddr->addr[0], addedAddr->addr[1], addedAddr->addr[2], addedAddr->addr[3], *(short *)&addedAddr->addr[4], par->getcurrtime());
     LOG(thisNode, stdstring);
 }
@@ -125,7 +144,48 @@ void Log::logNodeAdd(Address *thisNode, Address *addedAddr) {
  * DESCRIPTION: To log a node remove
  */
 void Log::logNodeRemove(Address *thisNode, Address *removedAddr) {
-	static char stdstring[30];
+	char stdstring[100];
 	sprintf(stdstring, "Node %d.%d.%d.%d:%d removed at time %d", removedAddr->addr[0], removedAddr->addr[1], removedAddr->addr[2], removedAddr->addr[3], *(short *)&removedAddr->addr[4], par->getcurrtime());
     LOG(thisNode, stdstring);
 }
+
+/**
+ * FUNCTION NAME: out
+ *
+ * DESCRIPTION: Return the console stream to print to: cout, or on a pool worker
+ * 				its own buffer, printed at the next flush
+ */
+ostream &Log::out() {
+	int self = ThreadPool::self();
+	if ( self >= 0 && self < (int)console.size() ) {
+		return console[self];
+	}
+	return cout;
+}
+
+/**
+ * FUNCTION NAME: setThreads
+ *
+ * DESCRIPTION: Hold the lines and the console output of count pool workers until flush
+ */
+void Log::setThreads(int count) {
+	pending.resize(count);
+	console.resize(count);
+}
+
+/**
+ * FUNCTION NAME: flush
+ *
+ * DESCRIPTION: Write the held lines and console output worker by worker, in the
+ * 				order they were logged. Called between pool runs only.
+ */
+void Log::flush() {
+	for ( unsigned int i = 0; i < pending.size(); i++ ) {
+		for ( unsigned int j = 0; j < pending[i].size(); j++ ) {
+			write(&pending[i][j].addr, pending[i][j].text.c_str());
+		}
+		pending[i].clear();
+		cout << console[i].str();
+		console[i].str("");
+	}
+}
@@ -10,6 +10,7 @@
 #include "stdincludes.h"
 #include "Params.h"
 #include "Member.h"
+#include "ThreadPool.h"
 
 /*
  * Macros
@@ -20,6 +21,16 @@
 #define DBG_LOG "dbg.log"
 #define STATS_LOG "stats.log"
 
+/**
+ * Struct Name: log_line
+ *
+ * DESCRIPTION: Line logged by a pool worker, written out at the next flush
+ */
+typedef struct log_line {
+	Address addr;
+	string text;
+}log_line;
+
 /**
  * CLASS NAME: Log
  *
@@ -29,6 +40,11 @@ class Log{
 private:
 	Params *par;
 	bool firstTime;
+	// with worker threads, the lines of each worker not written yet
+	vector< vector<log_line> > pending;
+	// and what each worker printed to the console
+	vector<ostringstream> console;
+	void write(Address *, const char *);
 public:
 	Log(Params *p);
 	Log(const Log &anotherLog);
@@ -37,6 +53,9 @@ public:
 	void LOG(Address *, const char * str, ...);
 	void logNodeAdd(Address *, Address *);
 	void logNodeRemove(Address *, Address *);
+	ostream &out();
+	void setThreads(int count);
+	void flush();
 };
 
 #endif /* _LOG_H_ */
@@ -15,64 +15,489 @@
 Message::Message(){
 	this->messageType =DUMMYLASTMSGTYPE;
 }
+// build messages straight into the network's pooled buffers, ready for ENsendbuf
+Message::Message(EmulNet *net){
+	this->messageType =DUMMYLASTMSGTYPE;
+	this->net = net;
+}
+// decode a received message into an owned copy; a malformed one decodes as DUMMYLASTMSGTYPE
 Message::Message(char* b,size_t size){
 	this->buf=b;
-	this->messageType = this->getMessageType();
-	this->getAddress();
-	this->getHeartbeat();
-	this->getId();
-	this->getPort();
 	this->size = size;
-	MessageHdr *msg= (MessageHdr*)buf;
-    MemberListEntry* p = (MemberListEntry *)((char *)(msg+1) + sizeof(this->getAddress()->addr) + sizeof(long));
-	size = size - (sizeof(MessageHdr) + sizeof(this->getAddress()->addr) + sizeof(long));
-	size_t entrysize = 24;
-	while(size>0){
-		size -= entrysize;
-		this->memberList.push_back(*p);
-		p+=1;
+	MessageView view(b,size);
+	this->messageType = view.getMessageType();
+	this->id = view.getId();
+	this->port = view.getPort();
+	this->heartbeat = view.getHeartbeat();
+	this->base = view.getBase();
+	this->upto = view.getUpto();
+	this->fragment = view.getFragment();
+	this->fragments = view.getFragments();
+	this->subjectId = view.getSubjectId();
+	this->subjectPort = view.getSubjectPort();
+	EntryCursor cursor = view.getEntries();
+	MemberListEntry entry;
+	while(cursor.next(entry)){
+		this->memberList.push_back(entry);
+	}
+	EventCursor events = view.getEvents();
+	MemberEvent event;
+	while(events.next(event)){
+		this->eventList.push_back(event);
+	}
+	this->events = this->eventList.data();
+	this->eventCount = (int)this->eventList.size();
+	this->rangeList.resize(view.getRangeCount());
+	view.getRanges(this->rangeList.data());
+	this->ranges = this->rangeList.data();
+	this->rangeCount = (int)this->rangeList.size();
+	this->level = view.getLevel();
+	this->settled = view.getSettled();
+	this->silent = view.getSilent();
+}
+
+// validate a received message in place; a malformed one reads as DUMMYLASTMSGTYPE with no entries
+MessageView::MessageView(const char* b,size_t size): entries(b,0), events(b,0), ranges(b,0){
+	this->messageType = DUMMYLASTMSGTYPE;
+	this->count = 0;
+	this->eventCount = 0;
+	this->rangeCount = 0;
+	WireReader reader(b,size);
+	if(reader.getByte() != WIRE_VERSION){
+		return;
+	}
+	unsigned char type = reader.getByte();
+	this->id = (int)reader.getVarint();
+	this->port = (short)reader.getSVarint();
+	this->heartbeat = (long)reader.getVarint();
+	if(type == DELTAREP){
+		this->base = (long)reader.getVarint();
+		this->upto = (long)reader.getVarint();
+	}
+	unsigned long rangeCount = 0;
+	WireReader firstRange = reader;
+	if(type == DIGEST){
+		rangeCount = reader.getVarint();
+		if(rangeCount == 0 || rangeCount > DIGEST_MAX_RANGES){
+			return;
+		}
+		firstRange = reader;
+		for(unsigned long i=0;i<rangeCount;i++){
+			reader.getFixed32();
+			reader.getVarint();
+		}
+	}
+	unsigned long level = 0;
+	unsigned char settled = 0;
+	if(type == TREE){
+		level = reader.getVarint();
+		settled = reader.getByte();
+		rangeCount = reader.getVarint();
+		if(level > MERKLE_MAX_DEPTH || settled > 2 || rangeCount == 0 || rangeCount > TREE_MAX_NODES){
+			return;
+		}
+		unsigned long width = 1;
+		for(unsigned long l=0;l<level;l++){
+			width *= MERKLE_FANOUT;
+		}
+		// the indices must increase and stay within the level
+		firstRange = reader;
+		unsigned long index = 0;
+		for(unsigned long i=0;i<rangeCount && reader.ok();i++){
+			unsigned long delta = reader.getVarint();
+			if(i > 0 && delta == 0){
+				return;
+			}
+			index += delta;
+			if(index >= width){
+				return;
+			}
+			if(settled != 2){
+				reader.getFixed32();
+				reader.getVarint();
+			}
+		}
+	}
+	unsigned long eventCount = 0;
+	WireReader firstEvent = reader;
+	if(type >= PING && type < DUMMYLASTMSGTYPE){
+		this->subjectId = (int)reader.getVarint();
+		this->subjectPort = (short)reader.getSVarint();
+		eventCount = reader.getVarint();
+		// every event takes at least 4 bytes
+		if(eventCount > size / 4){
+			return;
+		}
+		firstEvent = reader;
+		for(unsigned long i=0;i<eventCount && reader.ok();i++){
+			if(reader.getByte() >= DUMMYLASTEVENTTYPE){
+				return;
+			}
+			reader.getVarint();
+			reader.getSVarint();
+			reader.getVarint();
+		}
+	}
+	unsigned long count = 0;
+	WireReader first = reader;
+	if(type == JOINREP || type == DELTAREP){
+		this->fragment = (int)reader.getVarint();
+		this->fragments = (int)reader.getVarint();
+		if(this->fragment >= this->fragments){
+			return;
+		}
+		count = reader.getVarint();
+		// every entry takes at least 3 bytes
+		if(count > size / 3){
+			return;
+		}
+		// walk the entries once so that a malformed message is rejected before any is used
+		first = reader;
+		for(unsigned long i=0;i<count && reader.ok();i++){
+			reader.getVarint();
+			reader.getSVarint();
+			reader.getSVarint();
+		}
+	}
+	if(!reader.ok() || !reader.atEnd() || type >= DUMMYLASTMSGTYPE){
+		return;
+	}
+	this->messageType = (MsgTypes)type;
+	this->count = count;
+	this->entries = first;
+	this->eventCount = eventCount;
+	this->events = firstEvent;
+	this->rangeCount = (int)rangeCount;
+	this->ranges = firstRange;
+	this->level = (int)level;
+	this->settled = settled >= 1;
+	this->silent = settled == 2;
+}
+
+MsgTypes MessageView::getMessageType(){
+	return this->messageType;
+}
+Address MessageView::getAddress(){
+	Address addr;
+	addr.init();
+	memcpy(&addr.addr[0], &this->id, sizeof(int));
+	memcpy(&addr.addr[4], &this->port, sizeof(short));
+	return addr;
+}
+int MessageView::getId(){
+	return this->id;
+}
+short MessageView::getPort(){
+	return this->port;
+}
+long MessageView::getHeartbeat(){
+	return this->heartbeat;
+}
+long MessageView::getBase(){
+	return this->base;
+}
+long MessageView::getUpto(){
+	return this->upto;
+}
+int MessageView::getFragment(){
+	return this->fragment;
+}
+int MessageView::getFragments(){
+	return this->fragments;
+}
+int MessageView::getSubjectId(){
+	return this->subjectId;
+}
+short MessageView::getSubjectPort(){
+	return this->subjectPort;
+}
+Address MessageView::getSubject(){
+	Address subject;
+	subject.init();
+	memcpy(&subject.addr[0], &this->subjectId, sizeof(int));
+	memcpy(&subject.addr[4], &this->subjectPort, sizeof(short));
+	return subject;
+}
+unsigned long MessageView::getEntryCount(){
+	return this->count;
+}
+// a cursor over the entries, decoded one at a time straight from the buffer
+EntryCursor MessageView::getEntries(){
+	return EntryCursor(this->entries, this->count, this->heartbeat);
+}
+
+unsigned long MessageView::getEventCount(){
+	return this->eventCount;
+}
+// a cursor over the piggybacked events, decoded one at a time straight from the buffer
+EventCursor MessageView::getEvents(){
+	return EventCursor(this->events, this->eventCount);
+}
+
+int MessageView::getRangeCount(){
+	return this->rangeCount;
+}
+// copy the ranges of a digest, or the nodes of a tree level, to out, which holds getRangeCount() of them
+int MessageView::getRanges(RangeDigest *out){
+	WireReader reader = this->ranges;
+	int index = 0;
+	for(int i=0;i<this->rangeCount;i++){
+		index = this->messageType == TREE ? index + (int)reader.getVarint() : i;
+		out[i].index = index;
+		out[i].hash = this->silent ? 0 : reader.getFixed32();
+		out[i].beats = this->silent ? 0 : reader.getVarint();
+	}
+	return this->rangeCount;
+}
+// the tree level of a TREE message
+int MessageView::getLevel(){
+	return this->level;
+}
+// whether the sender of a TREE message settled its nodes, and only wants entries back
+bool MessageView::getSettled(){
+	return this->settled;
+}
+// whether the nodes of a TREE message are the sender's leaves going silent, sent without summaries
+bool MessageView::getSilent(){
+	return this->silent;
+}
+
+EntryCursor::EntryCursor(WireReader reader,unsigned long count,long heartbeat): reader(reader){
+	this->left = count;
+	this->heartbeat = heartbeat;
+	this->prevId = 0;
+}
+// decode the next entry into entry; false once every entry was read
+bool EntryCursor::next(MemberListEntry &entry){
+	if(this->left == 0){
+		return false;
+	}
+	this->left--;
+	this->prevId += (int)this->reader.getVarint();
+	entry.id = this->prevId;
+	entry.port = (short)this->reader.getSVarint();
+	entry.heartbeat = this->heartbeat - this->reader.getSVarint();
+	entry.timestamp = 0;
+	return true;
+}
+
+EventCursor::EventCursor(WireReader reader,unsigned long count): reader(reader){
+	this->left = count;
+}
+// decode the next event into event; false once every event was read
+bool EventCursor::next(MemberEvent &event){
+	if(this->left == 0){
+		return false;
+	}
+	this->left--;
+	event.type = this->reader.getByte();
+	event.id = (int)this->reader.getVarint();
+	event.port = (short)this->reader.getSVarint();
+	event.incarnation = (long)this->reader.getVarint();
+	return true;
+}
+
+bool compareEntryId(const MemberListEntry &a, const MemberListEntry &b){
+	return a.id < b.id;
+}
+
+// by id, and the highest heartbeat first among entries of the same id
+bool compareEntryIdNewest(const MemberListEntry &a, const MemberListEntry &b){
+	return a.id < b.id || (a.id == b.id && a.heartbeat > b.heartbeat);
+}
+
+// write the message in the wire format; with a NULL buffer only the size is computed
+size_t Message::encode(char* out){
+	WireWriter writer(out);
+	writer.putByte(WIRE_VERSION);
+	writer.putByte((unsigned char)this->messageType);
+	writer.putVarint((unsigned long)this->id);
+	writer.putSVarint(this->port);
+	writer.putVarint((unsigned long)this->heartbeat);
+	if(this->messageType == DELTAREP){
+		writer.putVarint((unsigned long)this->base);
+		writer.putVarint((unsigned long)this->upto);
+	}
+	if(this->messageType == DIGEST){
+		writer.putVarint((unsigned long)this->rangeCount);
+		for(int i=0;i<this->rangeCount;i++){
+			writer.putFixed32(this->ranges[i].hash);
+			writer.putVarint(this->ranges[i].beats);
+		}
+	}
+	if(this->messageType == TREE){
+		writer.putVarint((unsigned long)this->level);
+		writer.putByte(this->silent ? 2 : this->settled ? 1 : 0);
+		writer.putVarint((unsigned long)this->rangeCount);
+		int prevIndex = 0;
+		for(int i=0;i<this->rangeCount;i++){
+			writer.putVarint((unsigned long)(this->ranges[i].index - prevIndex));
+			if(!this->silent){
+				writer.putFixed32(this->ranges[i].hash);
+				writer.putVarint(this->ranges[i].beats);
+			}
+			prevIndex = this->ranges[i].index;
+		}
+	}
+	if(this->messageType >= PING && this->messageType < DUMMYLASTMSGTYPE){
+		writer.putVarint((unsigned long)this->subjectId);
+		writer.putSVarint(this->subjectPort);
+		writer.putVarint((unsigned long)this->eventCount);
+		for(int i=0;i<this->eventCount;i++){
+			const MemberEvent &event = this->events[i];
+			writer.putByte((unsigned char)event.type);
+			writer.putVarint((unsigned long)event.id);
+			writer.putSVarint(event.port);
+			writer.putVarint((unsigned long)event.incarnation);
+		}
+	}
+	if(this->messageType == JOINREP || this->messageType == DELTAREP){
+		writer.putVarint((unsigned long)this->fragment);
+		writer.putVarint((unsigned long)this->fragments);
+		writer.putVarint((unsigned long)this->count);
+		int prevId = 0;
+		for(int i=0;i<this->count;i++){
+			const MemberListEntry &entry = this->entries[i];
+			writer.putVarint((unsigned long)(entry.id - prevId));
+			writer.putSVarint(entry.port);
+			writer.putSVarint(this->heartbeat - entry.heartbeat);
+			prevId = entry.id;
+		}
 	}
+	return writer.getSize();
+}
 
+// fill in the fields every message carries, then size, allocate and encode it
+void Message::build(MsgTypes type,Address &address,long heartbeat){
+	this->messageType = type;
+	this->id = *(int*)(&address.addr);
+	this->port = *(short*)(&address.addr[4]);
+	this->heartbeat = heartbeat;
+	this->size = encode(NULL);
+	this->buf = allocBuf(this->size);
+	encode(this->buf);
 }
 
-// create JOINREQ message: format of data is {MessageHdr,Address.char[6],long heartbeat}
+// create JOINREQ message
 void Message::SetJoiner(Address address,long heartbeat){
-	size_t msize = sizeof(MessageHdr) + sizeof(address.addr)+sizeof(long);
-	this->buf=(char*)malloc(msize * sizeof(char));
-	MessageHdr *msg= (MessageHdr*)buf;
-    msg->msgType = JOINREQ;
-    //msg + sizeof(MessageHdr)
-    memcpy((char *)(msg+1), &address.addr, 6);
-    //msg + sizeof(MessageHdr) + sizeof(address.addr)
-    memcpy((char *)(msg+1) + sizeof(address.addr), &heartbeat, sizeof(long));
-    this->size = msize;
-}
-
-// create JOINREP message: format of data is {MessageHdr,Address.char[6],long heartbeat,[MemberListEntry|]}
-void Message::setJoinep(Address address,long heartbeat,vector<MemberListEntry> memberList){
-	size_t msize = sizeof(MessageHdr) + sizeof(address.addr)+sizeof(long);
-    size_t s =0;
-	if(memberList.size()!=0){
-		MemberListEntry entry = memberList[0];
-		msize +=sizeof(entry)*memberList.size();
-	}
-	this->buf=(char*)malloc(msize * sizeof(char));
-	MessageHdr *msg= (MessageHdr*)buf;
-    msg->msgType = JOINREP;
-    //msg + sizeof(MessageHdr)
-    memcpy((char *)(msg+1), &address.addr, sizeof(address.addr));
-    //msg + sizeof(MessageHdr) + sizeof(address.addr)
-    memcpy((char *)(msg+1) + sizeof(address.addr), &heartbeat, sizeof(long));
-    MemberListEntry* p = (MemberListEntry *)((char *)(msg+1) + sizeof(address.addr) + sizeof(long));
-
-	for(int i=0;i<memberList.size();i++){
-		MemberListEntry entry = memberList[i];
-		s = sizeof(entry);
-	    memcpy(p, &entry, sizeof(entry));
-	    p+=1;
-	}
-	cout<<s<<endl;
-	this->size = msize;
+	build(JOINREQ,address,heartbeat);
+}
+
+// keep a sorted copy of memberList, for the setters that take a vector
+void Message::ownEntries(vector<MemberListEntry> &memberList){
+	this->memberList.swap(memberList);
+	sort(this->memberList.begin(), this->memberList.end(), compareEntryId);
+	this->entries = this->memberList.data();
+	this->count = (int)this->memberList.size();
+}
+
+// create JOINREP message, carrying memberList, or one fragment of a longer list
+void Message::setJoinep(Address address,long heartbeat,vector<MemberListEntry> memberList,int fragment,int fragments){
+	ownEntries(memberList);
+	setJoinep(address,heartbeat,this->entries,this->count,fragment,fragments);
+}
+
+// create JOINREP message from count entries already sorted by id; they are only read while encoding
+void Message::setJoinep(Address address,long heartbeat,const MemberListEntry *entries,int count,int fragment,int fragments){
+	this->fragment = fragment;
+	this->fragments = fragments;
+	this->entries = entries;
+	this->count = count;
+	build(JOINREP,address,heartbeat);
+}
+
+// create DELTAREP message, carrying the entries that changed after version base, up to version upto
+void Message::setDelta(Address address,long heartbeat,long base,long upto,vector<MemberListEntry> memberList,int fragment,int fragments){
+	ownEntries(memberList);
+	setDelta(address,heartbeat,base,upto,this->entries,this->count,fragment,fragments);
+}
+
+// create DELTAREP message from count entries already sorted by id; they are only read while encoding
+void Message::setDelta(Address address,long heartbeat,long base,long upto,const MemberListEntry *entries,int count,int fragment,int fragments){
+	this->fragment = fragment;
+	this->fragments = fragments;
+	this->base = base;
+	this->upto = upto;
+	this->entries = entries;
+	this->count = count;
+	build(DELTAREP,address,heartbeat);
+}
+
+// create SYNCREQ message
+void Message::setSyncReq(Address address,long heartbeat){
+	build(SYNCREQ,address,heartbeat);
+}
+
+// create DIGEST message, summing up the sender's list in count id ranges; they are only read while encoding
+void Message::setDigest(Address address,long heartbeat,const RangeDigest *ranges,int count){
+	this->ranges = ranges;
+	this->rangeCount = count;
+	build(DIGEST,address,heartbeat);
+}
+
+// create TREE message, summing up count nodes of one level of the sender's tree, sorted by index; they are only read while encoding
+void Message::setTree(Address address,long heartbeat,int level,bool settled,const RangeDigest *nodes,int count){
+	this->level = level;
+	this->settled = settled;
+	this->silent = false;
+	this->ranges = nodes;
+	this->rangeCount = count;
+	build(TREE,address,heartbeat);
+}
+
+// create TREE message naming count leaves of the sender's tree going silent, sorted by index; only their indices are sent
+void Message::setSilent(Address address,long heartbeat,int level,const RangeDigest *leaves,int count){
+	this->level = level;
+	this->settled = true;
+	this->silent = true;
+	this->ranges = leaves;
+	this->rangeCount = count;
+	build(TREE,address,heartbeat);
+}
+
+// fill in the subject of a SWIM message, then build it
+void Message::buildProbe(MsgTypes type,Address &address,long heartbeat,Address &subject){
+	this->subjectId = *(int*)(&subject.addr);
+	this->subjectPort = *(short*)(&subject.addr[4]);
+	build(type,address,heartbeat);
+}
+
+// create PING message
+void Message::setPing(Address address,long heartbeat){
+	buildProbe(PING,address,heartbeat,address);
+}
+
+// create ACK message, vouching that subject answered a ping
+void Message::setAck(Address address,long heartbeat,Address subject){
+	buildProbe(ACK,address,heartbeat,subject);
+}
+
+// create PINGREQ message, asking the receiver to ping subject for us
+void Message::setPingReq(Address address,long heartbeat,Address subject){
+	buildProbe(PINGREQ,address,heartbeat,subject);
+}
+
+// create FAILED message, announcing that subject was confirmed failed
+void Message::setFailed(Address address,long heartbeat,Address subject){
+	buildProbe(FAILED,address,heartbeat,subject);
+}
+
+// create LEAVE message, announcing that subject left the group
+void Message::setLeave(Address address,long heartbeat,Address subject){
+	buildProbe(LEAVE,address,heartbeat,subject);
+}
+
+// piggyback events on the SWIM message built next
+void Message::setEvents(const MemberEvent *events,int count){
+	this->events = events;
+	this->eventCount = count;
+}
+
+char* Message::allocBuf(size_t size){
+	if(this->net != NULL){
+		return this->net->ENalloc(size);
+	}
+	return (char*)malloc(size * sizeof(char));
 }
 
 char* Message::getBuf(){
@@ -83,42 +508,76 @@ size_t Message::getSize(){
 	return this->size;
 }
 MsgTypes Message::getMessageType(){
-	return ((MessageHdr*) this->buf)->msgType;
+	return this->messageType;
 }
 
-vector<MemberListEntry> Message::getMemberListEntry(){
+vector<MemberListEntry>& Message::getMemberListEntry(){
 	return this->memberList;
 }
-Address* Message::getAddress(){
-	if(this->address == NULL){
-		Address* addr=new Address();
-		MessageHdr *msg= (MessageHdr*)this->buf;
-		memcpy(&addr->addr,(char *)(msg+1),6);
-		this->address= addr;
-	}
-	return this->address;
+vector<MemberEvent>& Message::getEvents(){
+	return this->eventList;
+}
+vector<RangeDigest>& Message::getRanges(){
+	return this->rangeList;
+}
+int Message::getLevel(){
+	return this->level;
+}
+bool Message::getSettled(){
+	return this->settled;
+}
+bool Message::getSilent(){
+	return this->silent;
+}
+Address Message::getAddress(){
+	Address addr;
+	addr.init();
+	memcpy(&addr.addr[0], &this->id, sizeof(int));
+	memcpy(&addr.addr[4], &this->port, sizeof(short));
+	return addr;
 }
 
 int Message::getId(){
-	if(this->id==-1){
-		this->id = *(int*)(&this->getAddress()->addr);
-	}
-	return id;
+	return this->id;
 }
 short Message::getPort(){
-	if(this->port==-1){
-		this->port = *(short*)(&this->getAddress()->addr[4]);
-	}
-	return port;
+	return this->port;
+}
+long Message::getBase(){
+	return this->base;
+}
+long Message::getUpto(){
+	return this->upto;
+}
+int Message::getFragment(){
+	return this->fragment;
+}
+int Message::getFragments(){
+	return this->fragments;
+}
+int Message::getSubjectId(){
+	return this->subjectId;
+}
+Address Message::getSubject(){
+	Address subject;
+	subject.init();
+	memcpy(&subject.addr[0], &this->subjectId, sizeof(int));
+	memcpy(&subject.addr[4], &this->subjectPort, sizeof(short));
+	return subject;
 }
 long Message::getHeartbeat(){
-	if(this->heartbeat==-1){
-		this->heartbeat = (long)*(buf+sizeof(MessageHdr) + 6);
-	}
 	return this->heartbeat;
 }
 
 
+Address createAddress(int id, short port){
+	Address address;
+	address.init();
+	memcpy(&address.addr[0], &id,sizeof(int));
+	memcpy(&address.addr[4], &port, sizeof(short));
+	return address;
+}
+
 /**
  * Overloaded Constructor of the MP1Node class
  * You can add new members to the class if you think it
@@ -133,6 +592,17 @@ MP1Node::MP1Node(Member *member, Params *params, EmulNet *emul, Log *log, Addres
 	this->log = log;
 	this->par = params;
 	this->memberNode->addr = *address;
+	this->memberTable.attach(&this->memberNode->memberList);
+	this->versionClock = 0;
+	this->probeNext = 0;
+	this->probeTarget = -1;
+	this->probeAcked = true;
+	this->incarnation = 0;
+	this->joinAttempt = 0;
+	this->joinDeadline = 0;
+	this->staleTick = -1;
+	this->regionReps.resize(params->REGIONS);
+	this->randSeed = (unsigned int)params->SEED * 2654435761u + *(int *)(&address->addr);
 }
 
 /**
@@ -213,7 +683,7 @@ int MP1Node::initThisNode(Address *joinaddr) {
     // node is up!
 	memberNode->nnb = 0;
 	memberNode->heartbeat = 0;
-	memberNode->pingCounter = TFAIL;
+	memberNode->pingCounter = par->SWIM_PERIOD;
 	memberNode->timeOutCounter = -1;
     initMemberListTable(memberNode);
 
@@ -228,7 +698,7 @@ int MP1Node::initThisNode(Address *joinaddr) {
  */
 int MP1Node::introduceSelfToGroup(Address *joinaddr) {
 #ifdef DEBUGLOG
-    static char s[1024];
+    char s[1024];
 #endif
 
     if ( 0 == memcmp((char *)&(memberNode->addr.addr), (char *)&(joinaddr->addr), sizeof(memberNode->addr.addr))) {
@@ -239,34 +709,77 @@ int MP1Node::introduceSelfToGroup(Address *joinaddr) {
         memberNode->inGroup = true;
     }
     else {
-    	Message* message = new Message();
-    	message->SetJoiner(memberNode->addr,memberNode->heartbeat);
-
 #ifdef DEBUGLOG
         sprintf(s, "Trying to join...");
         log->LOG(&memberNode->addr, s);
 #endif
 
         // send JOINREQ message to introfducer member
-		// &memberNode->addr: the address of this noded
-		// joinaddr: the address of the coordinator
-        emulNet->ENsend(&memberNode->addr, joinaddr, message->getBuf(), message->getSize());
-
+        sendJoinRequest(joinaddr);
     }
 
     return 1;
 
 }
 
+/**
+ * FUNCTION NAME: sendJoinRequest
+ *
+ * DESCRIPTION: Send JOINREQ to joinaddr, and give it JOIN_TIMEOUT ticks to answer.
+ * 				An introducer sends it to every other introducer instead, so that
+ * 				the introducers know each other and gossip what they learn.
+ */
+void MP1Node::sendJoinRequest(Address *joinaddr) {
+	int id = *(int*)(&memberNode->addr.addr);
+	Message message(emulNet);
+	message.SetJoiner(memberNode->addr,memberNode->heartbeat);
+	joinDeadline = this->par->getcurrtime() + JOIN_TIMEOUT;
+	if( id > par->INTRODUCERS ) {
+		emulNet->ENsendbuf(&memberNode->addr, joinaddr, message.getBuf(), message.getSize());
+		return;
+	}
+	Address *introducers = scratch.allocArray<Address>(par->INTRODUCERS);
+	int count = 0;
+	for( int i = 1; i <= par->INTRODUCERS; i++ ) {
+		if( i != id ) {
+			introducers[count++] = createAddress(i, 0);
+		}
+	}
+	emulNet->ENmulticast(&memberNode->addr, introducers, count, message.getBuf(), message.getSize());
+}
+
+/**
+ * FUNCTION NAME: retryJoin
+ *
+ * DESCRIPTION: Not in the group JOIN_TIMEOUT ticks after the last JOINREQ: ask the next introducer
+ */
+void MP1Node::retryJoin() {
+	if( this->par->getcurrtime() < joinDeadline ) {
+		return;
+	}
+	joinAttempt++;
+	Address joinaddr = getJoinAddress();
+	sendJoinRequest(&joinaddr);
+}
+
 /**
  * FUNCTION NAME: finishUpThisNode
  *
  * DESCRIPTION: Wind up this node and clean up state
  */
 int MP1Node::finishUpThisNode(){
-   /*
-    * Your code goes here
-    */
+	if( memberNode->bFailed || !memberNode->inGroup ) {
+		return 0;
+	}
+	// tell a few members that I leave; they spread it like a failure, without waiting for a timeout
+	Address *targets = scratch.allocArray<Address>(GOSSIPYSIZE);
+	int count = randomMembers(GOSSIPYSIZE, -1, targets);
+	sendProbe(LEAVE, targets, count, memberNode->addr);
+	scratch.reset();
+	// left for good: no more messages, and no join retries, until initThisNode
+	memberNode->inGroup = false;
+	memberNode->inited = false;
+	return 1;
 }
 
 /**
@@ -276,21 +789,30 @@ int MP1Node::finishUpThisNode(){
  * 				Check your messages in queue and perform membership protocol duties
  */
 void MP1Node::nodeLoop() {
-    if (memberNode->bFailed) {
+    if (memberNode->bFailed || !memberNode->inited) {
     	return;
     }
 
     // Check my messages
     checkMessages();
+    replyJoiners();
 
     // Wait until you're in the group...
     if( !memberNode->inGroup ) {
+    	retryJoin();
+    	changes.flush();
+    	scratch.reset();
     	return;
     }
 
     // ...then jump in and share your responsibilites!
     nodeLoopOps();
 
+    // listeners get this tick's changes in one batch
+    changes.flush();
+    // the scratch objects of this tick are no longer referenced
+    scratch.reset();
+
     return;
 }
 
@@ -309,7 +831,10 @@ void MP1Node::checkMessages() {
     	size = memberNode->mp1q.front().size;
     	memberNode->mp1q.pop();
     	recvCallBack((void *)memberNode, (char *)ptr, size);
+    	// the payload came out of the network's pool by reference; hand it back
+    	emulNet->ENfree((char *)ptr);
     }
+    mergeBatch();
     return;
 }
 
@@ -322,28 +847,73 @@ bool MP1Node::recvCallBack(void *env, char *data, int size ) {
 	/*
 	 * Your code goes here
 	 */
-	this->memberNode->inGroup = true;
 	 Member *memberNode = (Member *) env;
-	 Message* message=new Message(data,(size_t)size);
+	 // a node that has left drops whatever still reaches it
+	 if( !memberNode->inited ) {
+	 	 return false;
+	 }
+	 MessageView message(data,(size_t)size);
 	#ifdef DEBUGLOG
-	 	 cout<<"Yo, " << memberNode->addr.getAddress() << " received a new message: ";
+	 	 log->out()<<"Yo, " << memberNode->addr.getAddress() << " received a new message: ";
     #endif
-	 switch(message->getMessageType()){
+	 // batched entries go in before anything that could depend on them
+	 if((message.getMessageType() != JOINREP && message.getMessageType() != DELTAREP) || message.getEventCount() > 0){
+	 	 mergeBatch();
+	 }
+	 // hearing from a suspect directly clears the suspicion
+	 clearSuspect(message.getId());
+	 // piggybacked events first, so that a reply can already carry our answer to them
+	 applyEvents(message.getEvents());
+	 switch(message.getMessageType()){
 	 	 case     JOINREQ :
 	 		 handleJoinRequest(message);
 	 		 break;
 	 	 case 	   JOINREP :
 	 		handleGossipyRequest(message);
 	 		 break;
+	 	 case 	   DELTAREP :
+	 		handleDelta(message);
+	 		 break;
+	 	 case 	   SYNCREQ :
+	 		handleSyncRequest(message);
+	 		 break;
+	 	 case 	   DIGEST :
+	 		handleDigest(message);
+	 		 break;
+	 	 case 	   TREE :
+	 		handleTree(message);
+	 		 break;
+	 	 case 	   PING :
+	 		handlePing(message);
+	 		 break;
+	 	 case 	   ACK :
+	 		handleAck(message);
+	 		 break;
+	 	 case 	   PINGREQ :
+	 		handlePingRequest(message);
+	 		 break;
+	 	 case 	   FAILED :
+	 	 case 	   LEAVE :
+	 		handleRemoval(message);
+	 		 break;
 	 	 case      DUMMYLASTMSGTYPE :
-	 		 cout << " DUMMYLASTMSGTYPE "<<endl;
+	#ifdef DEBUGLOG
+	 		 log->out() << " DUMMYLASTMSGTYPE "<<endl;
+	#endif
 	 		 break;
 	 	 default:
-	 		 cout << "UNrecognized message";
+	#ifdef DEBUGLOG
+	 		 log->out() << "UNrecognized message";
+	#endif
+	 		 break;
 	 }
 	 return true;
 }
-void updateMemberList(Member *memberNode, long currenttime,vector<MemberListEntry> newMemberList){
+/**
+ * merge received entries, decoded one at a time from the message buffer; with
+ * BATCH_MERGE they are only collected, and merged by mergeBatch
+ */
+void MP1Node::updateMemberList(EntryCursor entries){
 	#ifdef DEBUGLOG
 //		cout <<endl;
 //		cout <<"node: " << memberNode->addr.getAddress() << " memberList received from: " << srcAddress->getAddress() <<endl;
@@ -351,22 +921,13 @@ void updateMemberList(Member *memberNode, long currenttime,vector<MemberListEntr
 //			cout<<"address: " << newMemberList[i].id<<" heartbeat: " << newMemberList[i].heartbeat <<endl;
 //		}
 	#endif
-	for(int i=0;i<memberNode->memberList.size();i++){
-		for(int k=0;k<newMemberList.size();k++){
-			if(memberNode->memberList[i].id==newMemberList[k].id){
-				if(newMemberList[k].heartbeat >= memberNode->memberList[i].heartbeat){
-					memberNode->memberList[i].heartbeat = newMemberList[k].heartbeat;
-					memberNode->memberList[i].timestamp = currenttime;
-				}
-				newMemberList.erase(newMemberList.begin()+k);
-				break;
-			}
+	MemberListEntry incoming;
+	while(entries.next(incoming)){
+		if(par->BATCH_MERGE){
+			batchEntry(incoming);
 		}
-	}
-	for(int i=0;i<newMemberList.size();i++){
-		if(newMemberList[i].id!=0){
-			newMemberList[i].timestamp=currenttime;
-			memberNode->memberList.push_back(newMemberList[i]);
+		else{
+			mergeEntry(incoming);
 		}
 	}
 	#ifdef DEBUGLOG
@@ -378,137 +939,1191 @@ void updateMemberList(Member *memberNode, long currenttime,vector<MemberListEntr
 }
 
 /**
- *  help function, handle join request
+ * help function, merge one received entry: a newer heartbeat refreshes a known
+ * entry, an unknown member is added
  */
-void MP1Node::handleGossipyRequest(Message *message){
-
-	updateMemberList(this->memberNode, this->par->getcurrtime(),message->getMemberListEntry());
-
-	// debug
-	#ifdef DEBUGLOG
-	cout << "JOINREP from: " << message->getId()<<":"<<message->getPort() << " HeartBeat: "<< message->getHeartbeat()<<endl;
-	#endif
+void MP1Node::mergeEntry(const MemberListEntry &incoming){
+	MemberListEntry *entry = memberTable.find(incoming.id);
+	if(entry != NULL){
+		// only a newer heartbeat refreshes the entry; re-gossiped copies of
+		// the same heartbeat must not keep a silent node alive
+		if(incoming.heartbeat > entry->heartbeat){
+			setHeartbeat(*entry, incoming.heartbeat);
+			refreshEntry(*entry);
+			touchEntry(*entry);
+			clearSuspect(entry->id);
+		}
+	}
+	// members confirmed failed stay out until stale copies of them are gone
+	else if(incoming.id!=0 && !isFailed(incoming.id) && admitEntry(incoming.id)){
+		MemberListEntry &added = addEntry(incoming);
+		refreshEntry(added);
+		touchEntry(added);
+	}
 }
 
-
-
 /**
- *  help function, handle join request
+ * help function, with BATCH_MERGE, hold a received entry until mergeBatch. For a
+ * known member only the highest heartbeat past the one in the list is kept, in
+ * batchBeats at the member's position; the list does not change until then.
  */
-void MP1Node::handleJoinRequest(Message *message){
-	cout << "JOINREQ Message from: " << message->getId()<<":"<<message->getPort() << " HeartBeat: "<< message->getHeartbeat()<< ", at timestamp: "<<this->par->getcurrtime() <<endl;
-	MemberListEntry *entry = new MemberListEntry(message->getId(),message->getPort(),message->getHeartbeat(),this->par->getcurrtime());
-
-	for(vector<MemberListEntry>::iterator item = memberNode->memberList.begin(); item !=memberNode->memberList.end();++item){
-		if(item->id == entry->id){
-			item->heartbeat = max(item->heartbeat,entry->heartbeat);
-			item->port = entry->port;
-			item->timestamp = entry->timestamp;
-			return;
+void MP1Node::batchEntry(const MemberListEntry &incoming){
+	int i = memberTable.indexOf(incoming.id);
+	if(i < 0){
+		batch.push_back(incoming);
+		return;
+	}
+	if((int)batchBeats.size() <= i){
+		batchBeats.resize(memberTable.size(), 0);
+	}
+	if(incoming.heartbeat > batchBeats[i] && incoming.heartbeat > memberNode->memberList[i].heartbeat){
+		if(batchBeats[i] == 0){
+			batchSlots.push_back(i);
 		}
+		batchBeats[i] = incoming.heartbeat;
 	}
-	memberNode->memberList.push_back(*entry);
-
 }
 
 /**
- * FUNCTION NAME: nodeLoopOps
- *
- * DESCRIPTION: Check if any node hasn't responded within a timeout period and then delete
- * 				the nodes
- * 				Propagate your membership list
+ * help function, with BATCH_MERGE, merge the entries held since the last call:
+ * each known member once at the highest heartbeat received, then the unknown
+ * ones, sorted by id with the newest heartbeat first so that only the first
+ * copy of each is merged
  */
-void MP1Node::nodeLoopOps() {
-	this->memberNode->heartbeat+=1;
-	// delete dead node
-	int i=0;
-	while(i<memberNode->memberList.size()){
-		MemberListEntry memberListEntry = memberNode->memberList[i];
-		if(this->memberNode->heartbeat - memberListEntry.heartbeat >= 2 * TIMEOUT){
-			#ifdef DEBUGLOG
-				cout<<"time out "<< memberNode->memberList[i].id<< "   " << this->memberNode->addr.getAddress()<<" gona erase memberlist entry: " << memberNode->memberList[i].id<<endl;
-			#endif
-			memberNode->memberList.erase(memberNode->memberList.begin()+i);
-			continue;
-		}
-		i++;
+void MP1Node::mergeBatch(){
+	for(size_t k = 0; k < batchSlots.size(); k++){
+		int i = batchSlots[k];
+		MemberListEntry newest = memberNode->memberList[i];
+		newest.heartbeat = batchBeats[i];
+		batchBeats[i] = 0;
+		mergeEntry(newest);
 	}
-	//int start = (rand() % (int)(max(0, (int) memberNode->memberList.size()-GOSSIPYSIZE)));
-	int start=0;
-//	//Propagate
-	for(int i=start;i<(int)memberNode->memberList.size();i++){
-		MemberListEntry entry=memberNode->memberList[i];
-		Member *member = this->memberNode;
-		propagateMemberList(entry,member);
+	batchSlots.clear();
+	if(batch.empty()){
+		return;
 	}
-    return;
+	sort(batch.begin(), batch.end(), compareEntryIdNewest);
+	for(size_t k = 0; k < batch.size(); k++){
+		if(k == 0 || batch[k].id != batch[k-1].id){
+			mergeEntry(batch[k]);
+		}
+	}
+	batch.clear();
 }
 
-Address* createAddress(int id, short port){
-	Address* address = new Address();
-	address->init();
-	memcpy(&address->addr[0], &id,sizeof(int));
-	memcpy(&address->addr[4], &port, sizeof(short));
-	return address;
+/**
+ * help function, record that an entry changed. In delta mode the entry gets a new
+ * version, and so goes out with the next delta, when it is new or its heartbeat
+ * moved by DELTA_HB_STEP since it was last announced.
+ */
+void MP1Node::touchEntry(MemberListEntry &entry){
+	if(!par->DELTA_GOSSIP){
+		return;
+	}
+	map<int, DeltaState>::iterator it = deltaState.find(entry.id);
+	if(it == deltaState.end()){
+		DeltaState state;
+		state.version = ++versionClock;
+		state.announced = entry.heartbeat;
+		deltaState[entry.id] = state;
+	}
+	else if(entry.heartbeat - it->second.announced >= par->DELTA_HB_STEP){
+		it->second.version = ++versionClock;
+		it->second.announced = entry.heartbeat;
+	}
 }
 
 /**
- * propagate memberlist to this memberEntry
+ * help function, note that we just heard of the entry. In heartbeat mode this
+ * pushes its removal deadline back to 2 * TIMEOUT from now, or with the phi
+ * detector to when phi would reach PHI_THRESHOLD.
  */
-void MP1Node::propagateMemberList(MemberListEntry memberEntry, Member *member){
-//	cout<<"propagateMemberList: " << memberEntry.id <<endl;
-	int memberID = *(int*)(&member->addr.addr);
-	if(memberID == memberEntry.id){
+void MP1Node::refreshEntry(MemberListEntry &entry){
+	entry.timestamp = this->par->getcurrtime();
+	if(par->SWIM_DETECTOR){
 		return;
 	}
-	int id = memberEntry.id;
-	short port = memberEntry.port;
-	Address* address = createAddress(id,port);
-	size_t msgsize=0;
-
-	Message *message = new Message();
-	message->setJoinep(member->addr,memberEntry.heartbeat,member->memberList);
+	long deadline = entry.timestamp + 2 * TIMEOUT;
+	if(par->PHI_THRESHOLD > 0){
+		ArrivalWindow &window = arrivals[entry.id];
+		window.arrival(entry.timestamp);
+		if(window.size() >= PHI_MIN_SAMPLES){
+			deadline = window.deadline(par->PHI_THRESHOLD);
+		}
+	}
+	timers.schedule(timerKey(entry.id, REMOVE_TIMER), deadline);
+}
 
-	Message *recMsg = new Message(message->getBuf(),message->getSize());
-    // send JOINREP message to introducer member
-	// &memberNode->addr: the address of this node
-	// address: the address of the target
-    emulNet->ENsend(&memberNode->addr, address, message->getBuf(), message->getSize());
+/**
+ * help function, drop the delta and SWIM bookkeeping and the timers of a removed entry
+ */
+void MP1Node::forgetEntry(int id){
+	deltaState.erase(id);
+	deltaPeers.erase(id);
+	relays.erase(id);
+	incarnations.erase(id);
+	arrivals.erase(id);
+	ring.remove(id);
+	if(!isLocal(id)){
+		vector<int> &reps = regionReps[regionOf(id)];
+		reps.erase(remove(reps.begin(), reps.end(), id), reps.end());
+	}
+	timers.cancel(timerKey(id, REMOVE_TIMER));
+	timers.cancel(timerKey(id, SUSPECT_TIMER));
 }
 
+/**
+ * help function, the timer wheel key of one kind of deadline of member id
+ */
+int MP1Node::timerKey(int id, TimerKinds kind){
+	return id * TIMER_KINDS + kind;
+}
 
+/**
+ * help function, whether member id is suspected
+ */
+bool MP1Node::isSuspect(int id){
+	return timers.pending(timerKey(id, SUSPECT_TIMER));
+}
 
 /**
- * FUNCTION NAME: isNullAddress
- *
- * DESCRIPTION: Function checks if the address is NULL
+ * help function, stop suspecting member id
  */
-int MP1Node::isNullAddress(Address *addr) {
-	return (memcmp(addr->addr, NULLADDR, 6) == 0 ? 1 : 0);
+void MP1Node::clearSuspect(int id){
+	timers.cancel(timerKey(id, SUSPECT_TIMER));
 }
 
 /**
- * FUNCTION NAME: getJoinAddress
- *
- * DESCRIPTION: Returns the Address of the coordinator
+ * help function, whether member id was confirmed failed less than TREMOVE ticks ago
  */
-Address MP1Node::getJoinAddress() {
-    Address joinaddr;
+bool MP1Node::isFailed(int id){
+	return timers.pending(timerKey(id, FAILED_TIMER));
+}
 
-    memset(&joinaddr, 0, sizeof(Address));
-    *(int *)(&joinaddr.addr) = 1;
-    *(short *)(&joinaddr.addr[4]) = 0;
+/**
+ * help function, the entry of member id, NULL if it is not in the list
+ */
+MemberListEntry *MP1Node::findEntry(int id){
+	return memberTable.find(id);
+}
 
-    return joinaddr;
+/**
+ * help function, add an entry to the list, its member to the ring and the tree,
+ * and report the join; my own entry, the first one, is no change
+ */
+MemberListEntry &MP1Node::addEntry(const MemberListEntry &entry){
+	ring.add(entry.id, entry.port);
+	merkle.add(entry.id, entry.port, entry.heartbeat);
+	if(memberTable.size() > 0){
+		changes.record(JOIN_CHANGE, entry.id, entry.port, this->par->getcurrtime());
+	}
+	return memberTable.insert(entry);
 }
 
 /**
- * FUNCTION NAME: initMemberListTable
- *
- * DESCRIPTION: Initialize the membership list
+ * help function, remove the entry of member id and report it as change; my own
+ * entry is never removed. The last entry takes the place of the removed one.
  */
-void MP1Node::initMemberListTable(Member *memberNode) {
-	memberNode->memberList.clear();
+void MP1Node::removeEntry(int id, ChangeTypes change){
+	if(memberTable.indexOf(id) > 0){
+		MemberListEntry *entry = memberTable.find(id);
+		changes.record(change, id, entry->port, this->par->getcurrtime());
+		merkle.remove(id, entry->port, entry->heartbeat);
+		forgetEntry(id);
+		memberTable.remove(id);
+	}
+}
+
+/**
+ *  help function, handle join request
+ */
+void MP1Node::handleGossipyRequest(MessageView &message){
+
+	updateMemberList(message.getEntries());
+	// the introducer answered: we are in
+	memberNode->inGroup = true;
+
+	// debug
+	#ifdef DEBUGLOG
+	log->out() << "JOINREP from: " << message.getId()<<":"<<message.getPort() << " HeartBeat: "<< message.getHeartbeat()<<endl;
+	#endif
+}
+
+
+
+/**
+ *  help function, handle delta gossip. A delta whose base is past what we have
+ *  received from the sender means one went missing: merge it anyway and ask
+ *  the sender for a full sync. A fragmented delta only counts as received
+ *  once all its fragments are in.
+ */
+void MP1Node::handleDelta(MessageView &message){
+	updateMemberList(message.getEntries());
+
+	DeltaPeer &peer = deltaPeers[message.getId()];
+	if(message.getBase() > peer.recv){
+		Address sender = message.getAddress();
+		Message request(emulNet);
+		request.setSyncReq(memberNode->addr,memberNode->heartbeat);
+		emulNet->ENsendbuf(&memberNode->addr, &sender, request.getBuf(), request.getSize());
+		return;
+	}
+	if(message.getFragments() > 1){
+		if(peer.pendingUpto != message.getUpto()){
+			peer.pendingUpto = message.getUpto();
+			peer.pendingFrags = 0;
+		}
+		if(++peer.pendingFrags < message.getFragments()){
+			return;
+		}
+	}
+	peer.recv = max(peer.recv, message.getUpto());
+}
+
+/**
+ *  help function, handle full sync request: the next delta to the sender starts from scratch
+ */
+void MP1Node::handleSyncRequest(MessageView &message){
+	deltaPeers[message.getId()].sent = 0;
+}
+
+/**
+ *  help function, handle digest: compare the sender's ranges with ours and send
+ *  back, as a JOINREP, our entries in the ranges where we know members the sender
+ *  does not, or where our heartbeats are ahead by DIGEST_HB_STEP. The sender
+ *  merges them like any gossiped list; when we are not ahead there is no reply.
+ */
+void MP1Node::handleDigest(MessageView &message){
+	int ranges = message.getRangeCount();
+	RangeDigest theirs[DIGEST_MAX_RANGES];
+	RangeDigest mine[DIGEST_MAX_RANGES];
+	message.getRanges(theirs);
+	int count;
+	MemberListEntry *entries = freshEntries(0, count);
+	digestOf(entries, count, mine, ranges);
+	int *sizes = scratch.allocArray<int>(ranges);
+	memset(sizes, 0, ranges * sizeof(int));
+	for(int i=0;i<count;i++){
+		sizes[(unsigned int)entries[i].id % ranges]++;
+	}
+	// the sender knows its own entry best
+	int differing = 0;
+	for(int i=0;i<count;i++){
+		int range = (int)((unsigned int)entries[i].id % ranges);
+		bool ahead = mine[range].hash != theirs[range].hash
+				|| mine[range].beats >= theirs[range].beats + (unsigned long)(par->DIGEST_HB_STEP * sizes[range]);
+		if(ahead && entries[i].id != message.getId()){
+			entries[differing++] = entries[i];
+		}
+	}
+	if(differing == 0){
+		return;
+	}
+	Address sender = message.getAddress();
+	sendEntries(JOINREP, &sender, 1, entries, differing, 0, 0);
+}
+
+/**
+ *  help function, handle one step of a tree walk. Where one of the sender's
+ *  nodes differs from ours, answer with our children of it, one level down.
+ *  At the leaves, or at a node with fewer than TREE_DESCEND_ENTRIES entries,
+ *  which is cheaper to send whole than to walk into, settle it instead: send
+ *  as a JOINREP our entries below it when the members differ or our heartbeats
+ *  are ahead by DIGEST_HB_STEP. When the members differ the sender may know
+ *  some we do not, so the node also goes back to it as settled, which only gets
+ *  entries in reply. Leaves the sender names as going silent get our entries
+ *  below them. Entries we have not heard from lately ourselves are no news.
+ */
+void MP1Node::handleTree(MessageView &message){
+	int depth = merkle.getDepth();
+	int level = message.getLevel();
+	if(depth == 0 || level > depth){
+		return;
+	}
+	// the sender's own heartbeat comes with every step
+	mergeEntry(MemberListEntry(message.getId(), message.getPort(), message.getHeartbeat(), this->par->getcurrtime()));
+	int count = message.getRangeCount();
+	RangeDigest *theirs = scratch.allocArray<RangeDigest>(count);
+	message.getRanges(theirs);
+	Address sender = message.getAddress();
+	RangeDigest *down = scratch.allocArray<RangeDigest>(TREE_MAX_NODES);
+	RangeDigest *back = scratch.allocArray<RangeDigest>(count);
+	char *wanted = scratch.allocArray<char>(merkle.width(level));
+	memset(wanted, 0, merkle.width(level));
+	int downs = 0, backs = 0;
+	bool sending = false;
+	for(int i=0;i<count;i++){
+		// leaves going silent want all of our entries below them
+		if(message.getSilent()){
+			wanted[theirs[i].index] = 1;
+			sending = true;
+			continue;
+		}
+		if(!treeDiffers(level, theirs[i])){
+			continue;
+		}
+		int size = merkle.at(level, theirs[i].index).count;
+		if(!message.getSettled() && level < depth && size >= TREE_DESCEND_ENTRIES){
+			// what does not fit in one message is left for the next round
+			if(downs + MERKLE_FANOUT <= TREE_MAX_NODES){
+				for(int c=0;c<MERKLE_FANOUT;c++){
+					down[downs++] = treeSummary(level + 1, theirs[i].index * MERKLE_FANOUT + c);
+				}
+			}
+			continue;
+		}
+		RangeDigest mine = treeSummary(level, theirs[i].index);
+		unsigned long step = (unsigned long)(par->DIGEST_HB_STEP * size);
+		bool members = mine.hash != theirs[i].hash;
+		if(members || mine.beats >= theirs[i].beats + step){
+			wanted[theirs[i].index] = 1;
+			sending = true;
+		}
+		if(!message.getSettled() && members){
+			back[backs++] = mine;
+		}
+	}
+	if(sending){
+		int entryCount;
+		MemberListEntry *entries = freshEntries(0, entryCount);
+		long now = this->par->getcurrtime();
+		// the sender knows its own entry best
+		int differing = 0;
+		for(int i=0;i<entryCount;i++){
+			if(!wanted[merkle.nodeOf(entries[i].id, level)] || entries[i].id == message.getId()){
+				continue;
+			}
+			// our own copies going silent are no news to the sender
+			if(now - entries[i].timestamp >= TIMEOUT / 2){
+				continue;
+			}
+			entries[differing++] = entries[i];
+		}
+		if(differing > 0){
+			sendEntries(JOINREP, &sender, 1, entries, differing, 0, 0);
+		}
+	}
+	if(downs > 0){
+		Message next(emulNet);
+		next.setTree(memberNode->addr, memberNode->heartbeat, level + 1, false, down, downs);
+		emulNet->ENsendbuf(&memberNode->addr, &sender, next.getBuf(), next.getSize());
+	}
+	if(backs > 0){
+		Message next(emulNet);
+		next.setTree(memberNode->addr, memberNode->heartbeat, level, true, back, backs);
+		emulNet->ENsendbuf(&memberNode->addr, &sender, next.getBuf(), next.getSize());
+	}
+}
+
+/**
+ *  help function, handle SWIM ping: ack it, vouching for myself
+ */
+void MP1Node::handlePing(MessageView &message){
+	Address sender = message.getAddress();
+	sendProbe(ACK, &sender, 1, memberNode->addr);
+}
+
+/**
+ *  help function, handle SWIM ack: the subject is alive. Settles our own probe of
+ *  it, and is passed on to the members that asked us to probe it.
+ */
+void MP1Node::handleAck(MessageView &message){
+	int id = message.getSubjectId();
+	Address subject = message.getSubject();
+	clearSuspect(id);
+	if(id == probeTarget){
+		probeAcked = true;
+	}
+	map<int, vector<Address> >::iterator relay = relays.find(id);
+	if(relay != relays.end()){
+		sendProbe(ACK, relay->second.data(), (int)relay->second.size(), subject);
+		relays.erase(relay);
+	}
+}
+
+/**
+ *  help function, handle SWIM ping request: ping the subject, and remember to
+ *  relay its ack to the sender
+ */
+void MP1Node::handlePingRequest(MessageView &message){
+	Address subject = message.getSubject();
+	relays[message.getSubjectId()].push_back(message.getAddress());
+	sendProbe(PING, &subject, 1, memberNode->addr);
+}
+
+/**
+ *  help function, handle failure or leave announcement: the first time we hear
+ *  of it, remove the member and pass the announcement on
+ */
+void MP1Node::handleRemoval(MessageView &message){
+	int id = message.getSubjectId();
+	if(id == *(int*)(&memberNode->addr.addr) || isFailed(id)){
+		return;
+	}
+	Address subject = message.getSubject();
+	confirmFailed(id, message.getMessageType() == LEAVE ? LEAVE_CHANGE : FAIL_CHANGE);
+	spreadRemoval(message.getMessageType(), subject);
+}
+
+/**
+ *  help function, handle join request
+ */
+void MP1Node::handleJoinRequest(MessageView &message){
+	#ifdef DEBUGLOG
+	log->out() << "JOINREQ Message from: " << message.getId()<<":"<<message.getPort() << " HeartBeat: "<< message.getHeartbeat()<< ", at timestamp: "<<this->par->getcurrtime() <<endl;
+	#endif
+	MemberListEntry entry(message.getId(),message.getPort(),message.getHeartbeat(),this->par->getcurrtime());
+	// the joiner gets the list with the others joining this tick
+	joiners.push_back(message.getAddress());
+
+	MemberListEntry *item = memberTable.find(entry.id);
+	if(item != NULL){
+		setHeartbeat(*item, max(item->heartbeat,entry.heartbeat));
+		if(item->port != entry.port){
+			merkle.remove(item->id, item->port, item->heartbeat);
+			item->port = entry.port;
+			merkle.add(item->id, item->port, item->heartbeat);
+		}
+		refreshEntry(*item);
+		touchEntry(*item);
+		return;
+	}
+	if(!admitEntry(entry.id)){
+		return;
+	}
+	MemberListEntry &added = addEntry(entry);
+	refreshEntry(added);
+	touchEntry(added);
+
+	// in piggyback mode everybody else hears of the joiner through an ALIVE event
+	if(par->PIGGYBACK){
+		queueEvent(ALIVE_EVENT, entry.id, entry.port, 0);
+	}
+}
+
+/**
+ *  help function, answer the joiners of this tick: the list is serialized once,
+ *  already holding all of them, and multicast to the whole batch
+ */
+void MP1Node::replyJoiners(){
+	if(joiners.empty()){
+		return;
+	}
+	int entryCount;
+	MemberListEntry *entries = freshEntries(0, entryCount);
+	sendEntries(JOINREP,joiners.data(),(int)joiners.size(),entries,entryCount,0,0);
+	joiners.clear();
+}
+
+/**
+ * FUNCTION NAME: nodeLoopOps
+ *
+ * DESCRIPTION: Check if any node hasn't responded within a timeout period and then delete
+ * 				the nodes
+ * 				Propagate your membership list
+ */
+void MP1Node::nodeLoopOps() {
+	long now = this->par->getcurrtime();
+	this->memberNode->heartbeat+=1;
+	// refresh my own entry, always at the front of the list
+	memberNode->myPos = memberNode->memberList.begin();
+	setHeartbeat(*memberNode->myPos, memberNode->heartbeat);
+	memberNode->myPos->timestamp = now;
+	touchEntry(*memberNode->myPos);
+	expireTimers();
+	if(par->SWIM_DETECTOR){
+		swimOps();
+	}
+
+	// gossip every GOSSIP_PERIOD ticks; in piggyback mode the SWIM messages carry the changes
+	if(par->PIGGYBACK || memberNode->heartbeat % par->GOSSIP_PERIOD != 0){
+		return;
+	}
+	// GOSSIPYSIZE random members by default; with fanout 0 every member is a target
+	int fanout = par->GOSSIP_FANOUT < 0 ? GOSSIPYSIZE : par->GOSSIP_FANOUT;
+	if(fanout == 0){
+		fanout = (int)memberNode->memberList.size();
+	}
+	Address *targets = scratch.allocArray<Address>(fanout);
+	int count = randomMembers(fanout, -1, targets);
+	if(par->DELTA_GOSSIP){
+		propagateDelta(targets, count);
+	}
+	else if(par->DIGEST_GOSSIP && merkle.getDepth() > 0){
+		propagateTree(targets, count);
+	}
+	else if(par->DIGEST_GOSSIP){
+		propagateDigest(targets, count);
+	}
+	else{
+		propagateMemberList(targets, count);
+	}
+	if(par->REGIONS){
+		propagateSummary();
+	}
+    return;
+}
+
+/**
+ * the region of member id, with REGIONS
+ */
+int MP1Node::regionOf(int id){
+	return (id - 1) % par->REGIONS;
+}
+
+/**
+ * whether member id is in my region; every member is without REGIONS
+ */
+bool MP1Node::isLocal(int id){
+	return !par->REGIONS || regionOf(id) == regionOf(*(int*)(&memberNode->addr.addr));
+}
+
+/**
+ * whether to add member id, not yet in the list. Members of my region always
+ * are; of another region only its REGION_REPS lowest ids we hear of, so that
+ * every member settles on the same representatives. A lower id evicts the
+ * highest one kept.
+ */
+bool MP1Node::admitEntry(int id){
+	if(isLocal(id)){
+		return true;
+	}
+	vector<int> &reps = regionReps[regionOf(id)];
+	if((int)reps.size() >= REGION_REPS){
+		if(id > reps.back()){
+			return false;
+		}
+		removeEntry(reps.back(), EVICT_CHANGE);
+	}
+	reps.insert(lower_bound(reps.begin(), reps.end(), id), id);
+	return true;
+}
+
+/**
+ * with REGIONS, a representative of my region, one of its REGION_REPS lowest ids,
+ * sends the representatives of every region it knows to a random representative
+ * of another region. The members of that region then gossip them on with the rest
+ * of their list, so each member keeps its region plus REGION_REPS members per
+ * other region.
+ */
+void MP1Node::propagateSummary(){
+	long now = this->par->getcurrtime();
+	int myId = *(int*)(&memberNode->addr.addr);
+	int size = (int)memberNode->memberList.size();
+	// the REGION_REPS lowest ids of my region, sorted
+	int lowest[REGION_REPS];
+	int kept = 0;
+	int foreign = 0;
+	for(int i=0;i<size;i++){
+		int id = memberNode->memberList[i].id;
+		if(!isLocal(id)){
+			foreign++;
+			continue;
+		}
+		if(kept < REGION_REPS || id < lowest[kept - 1]){
+			int j = min(kept, REGION_REPS - 1);
+			while(j > 0 && lowest[j - 1] > id){
+				lowest[j] = lowest[j - 1];
+				j--;
+			}
+			lowest[j] = id;
+			kept = min(kept + 1, REGION_REPS);
+		}
+	}
+	if(foreign == 0 || myId > lowest[kept - 1]){
+		return;
+	}
+	MemberListEntry *summary = scratch.allocArray<MemberListEntry>(size);
+	int count = 0;
+	int pick = rand_r(&randSeed) % foreign;
+	Address target;
+	for(int i=0;i<size;i++){
+		MemberListEntry &entry = memberNode->memberList[i];
+		bool local = isLocal(entry.id);
+		if(!local && pick-- == 0){
+			target = createAddress(entry.id, entry.port);
+		}
+		if(now - entry.timestamp >= TIMEOUT || (local && entry.id > lowest[kept - 1])){
+			continue;
+		}
+		summary[count++] = entry;
+	}
+	sendEntries(JOINREP, &target, 1, summary, count, 0, 0);
+}
+
+/**
+ * write up to count random members other than myself and member skip to members,
+ * picked with a partial Fisher-Yates shuffle of the entries after my own.
+ * Returns the number written.
+ */
+int MP1Node::randomMembers(int count, int skip, Address *members){
+	int *order = scratch.allocArray<int>((int)memberNode->memberList.size());
+	int peers = 0;
+	for(int i=1;i<(int)memberNode->memberList.size();i++){
+		if(memberNode->memberList[i].id != skip && isLocal(memberNode->memberList[i].id)){
+			order[peers++] = i;
+		}
+	}
+	count = min(count, peers);
+	for(int i=0;i<count;i++){
+		int j = i + rand_r(&randSeed) % (peers - i);
+		swap(order[i], order[j]);
+		MemberListEntry &entry=memberNode->memberList[order[i]];
+		members[i] = createAddress(entry.id,entry.port);
+	}
+	return count;
+}
+
+/**
+ * handle the deadlines that passed this tick, without looking at any other entry:
+ * entries silent for 2 * TIMEOUT are removed, suspects silent for suspicionTimeout() are
+ * confirmed failed, and ids confirmed failed TREMOVE ticks ago may be added again
+ */
+void MP1Node::expireTimers(){
+	vector<int> due;
+	timers.advance(this->par->getcurrtime(), due);
+	for(int i=0;i<(int)due.size();i++){
+		int id = due[i] / TIMER_KINDS;
+		MemberListEntry *entry = findEntry(id);
+		if(entry == NULL){
+			continue;
+		}
+		if(due[i] % TIMER_KINDS == REMOVE_TIMER && par->PHI_THRESHOLD > 0){
+			// phi can remove an entry while peers still gossip it: keep it out for TREMOVE
+			confirmFailed(id, FAIL_CHANGE);
+		}
+		else if(due[i] % TIMER_KINDS == REMOVE_TIMER){
+			#ifdef DEBUGLOG
+				log->out()<<"time out "<< id<< "   " << this->memberNode->addr.getAddress()<<" gona erase memberlist entry: " << id<<endl;
+			#endif
+			removeEntry(id, FAIL_CHANGE);
+		}
+		else if(due[i] % TIMER_KINDS == SUSPECT_TIMER){
+			Address subject = createAddress(entry->id,entry->port);
+			confirmFailed(id, FAIL_CHANGE);
+			spreadRemoval(FAILED, subject);
+		}
+	}
+}
+
+/**
+ * SWIM failure detection, run every tick in place of the heartbeat timeout.
+ * Each SWIM_PERIOD ticks one member, taken round robin from a shuffled order, is
+ * pinged. Without an ACK after PING_TIMEOUT ticks, SWIM_K other members are asked
+ * to ping it for us; without any ACK by the end of the period it is suspected.
+ * A suspect that shows no sign of life for suspicionTimeout() ticks is confirmed failed,
+ * removed and announced. Failed ids are kept for TREMOVE ticks so that stale
+ * gossip does not add them back.
+ */
+void MP1Node::swimOps(){
+	// direct ping timed out: probe indirectly
+	if(memberNode->timeOutCounter > 0 && --memberNode->timeOutCounter == 0 && !probeAcked){
+		MemberListEntry *entry = findEntry(probeTarget);
+		if(entry != NULL){
+			Address subject = createAddress(entry->id,entry->port);
+			Address *helpers = scratch.allocArray<Address>(par->SWIM_K);
+			int count = randomMembers(par->SWIM_K, probeTarget, helpers);
+			sendProbe(PINGREQ, helpers, count, subject);
+		}
+	}
+	if(--memberNode->pingCounter > 0){
+		return;
+	}
+	memberNode->pingCounter = par->SWIM_PERIOD;
+	if(!probeAcked && findEntry(probeTarget) != NULL && !isSuspect(probeTarget)){
+		suspectEntry(probeTarget);
+	}
+
+	// next member to probe; every member is probed once per round
+	probeTarget = -1;
+	probeAcked = true;
+	while(probeTarget == -1){
+		if(probeNext >= (int)probeOrder.size()){
+			probeOrder.clear();
+			for(int i=1;i<(int)memberNode->memberList.size();i++){
+				probeOrder.push_back(memberNode->memberList[i].id);
+			}
+			if(probeOrder.empty()){
+				return;
+			}
+			for(int i=(int)probeOrder.size()-1;i>0;i--){
+				swap(probeOrder[i], probeOrder[rand_r(&randSeed) % (i + 1)]);
+			}
+			probeNext = 0;
+		}
+		int id = probeOrder[probeNext++];
+		if(findEntry(id) != NULL){
+			probeTarget = id;
+		}
+	}
+	MemberListEntry *entry = findEntry(probeTarget);
+	Address target = createAddress(entry->id,entry->port);
+	probeAcked = false;
+	memberNode->timeOutCounter = PING_TIMEOUT;
+	sendProbe(PING, &target, 1, memberNode->addr);
+}
+
+/**
+ * start suspecting member id. In piggyback mode the suspicion is spread, and the
+ * suspect is pinged with it so that it can refute it in time.
+ */
+void MP1Node::suspectEntry(int id){
+	#ifdef DEBUGLOG
+		log->out()<<"suspect "<< id << "   " << this->memberNode->addr.getAddress()<<endl;
+	#endif
+	timers.schedule(timerKey(id, SUSPECT_TIMER), this->par->getcurrtime() + suspicionTimeout());
+	changes.record(SUSPECT_CHANGE, id, findEntry(id)->port, this->par->getcurrtime());
+	if(par->PIGGYBACK){
+		MemberListEntry *entry = findEntry(id);
+		Address suspect = createAddress(entry->id,entry->port);
+		queueEvent(SUSPECT_EVENT, id, entry->port, incarnationOf(id));
+		sendProbe(PING, &suspect, 1, memberNode->addr);
+	}
+}
+
+/**
+ * member id failed or left, as change tells: remove its entry and keep it out for
+ * TREMOVE ticks
+ */
+void MP1Node::confirmFailed(int id, ChangeTypes change){
+	#ifdef DEBUGLOG
+		log->out()<<"time out "<< id<< "   " << this->memberNode->addr.getAddress()<<" gona erase memberlist entry: " << id<<endl;
+	#endif
+	removeEntry(id, change);
+	clearSuspect(id);
+	timers.schedule(timerKey(id, FAILED_TIMER), this->par->getcurrtime() + TREMOVE);
+}
+
+/**
+ * announce that subject failed (FAILED) or left (LEAVE) to SWIM_K random members,
+ * who pass it on once. In piggyback mode it is queued as an event instead.
+ */
+void MP1Node::spreadRemoval(MsgTypes type, Address &subject){
+	if(par->PIGGYBACK){
+		queueEvent(type == LEAVE ? LEAVE_EVENT : FAILED_EVENT, *(int*)(&subject.addr), *(short*)(&subject.addr[4]), 0);
+		return;
+	}
+	Address *targets = scratch.allocArray<Address>(par->SWIM_K);
+	int count = randomMembers(par->SWIM_K, -1, targets);
+	sendProbe(type, targets, count, subject);
+}
+
+/**
+ * ticks a suspect has to show a sign of life: TFAIL, or in piggyback mode
+ * log2(N) protocol periods, long enough for its refutation to spread
+ */
+int MP1Node::suspicionTimeout(){
+	if(!par->PIGGYBACK){
+		return TFAIL;
+	}
+	return par->SWIM_PERIOD * (int)ceil(log2(memberNode->memberList.size() + 1));
+}
+
+/**
+ * queue a membership event for piggybacking
+ */
+void MP1Node::queueEvent(int type, int id, short port, long incarnation){
+	MemberEvent event;
+	event.type = type;
+	event.id = id;
+	event.port = port;
+	event.incarnation = incarnation;
+	dissemination.add(event);
+}
+
+/**
+ * the incarnation we know of member id
+ */
+long MP1Node::incarnationOf(int id){
+	map<int, long>::iterator it = incarnations.find(id);
+	return it == incarnations.end() ? 0 : it->second;
+}
+
+/**
+ * apply the events piggybacked on a received message
+ */
+void MP1Node::applyEvents(EventCursor events){
+	MemberEvent event;
+	while(events.next(event)){
+		applyEvent(event);
+	}
+}
+
+/**
+ * apply one membership event. Events that change what we know are queued again,
+ * so that they spread on. ALIVE adds an unknown member and, at a newer incarnation,
+ * clears its suspicion; SUSPECT at the known incarnation or newer starts one, and
+ * when it is about me I refute it with a newer incarnation; FAILED and LEAVE remove
+ * the member.
+ */
+void MP1Node::applyEvent(MemberEvent &event){
+	int myId = *(int*)(&memberNode->addr.addr);
+	if(event.id == myId){
+		if(event.type == SUSPECT_EVENT && event.incarnation >= incarnation){
+			incarnation = event.incarnation + 1;
+			queueEvent(ALIVE_EVENT, myId, *(short*)(&memberNode->addr.addr[4]), incarnation);
+		}
+		return;
+	}
+	if(event.id == 0 || isFailed(event.id)){
+		return;
+	}
+	MemberListEntry *entry = findEntry(event.id);
+	switch(event.type){
+		case ALIVE_EVENT:
+			if(entry == NULL){
+				MemberListEntry &added = addEntry(MemberListEntry(event.id, event.port, 0, this->par->getcurrtime()));
+				refreshEntry(added);
+			}
+			else if(event.incarnation <= incarnationOf(event.id)){
+				return;
+			}
+			clearSuspect(event.id);
+			break;
+		case SUSPECT_EVENT:
+			if(entry == NULL || isSuspect(event.id) || event.incarnation < incarnationOf(event.id)){
+				return;
+			}
+			timers.schedule(timerKey(event.id, SUSPECT_TIMER), this->par->getcurrtime() + suspicionTimeout());
+			changes.record(SUSPECT_CHANGE, event.id, entry->port, this->par->getcurrtime());
+			break;
+		default:
+			// also keeps a member we never heard of out, should its ALIVE come late
+			confirmFailed(event.id, event.type == LEAVE_EVENT ? LEAVE_CHANGE : FAIL_CHANGE);
+			dissemination.add(event);
+			return;
+	}
+	incarnations[event.id] = event.incarnation;
+	dissemination.add(event);
+}
+
+/**
+ * multicast a SWIM message about subject to targets
+ */
+void MP1Node::sendProbe(MsgTypes type, Address *targets, int count, Address &subject){
+	if(count == 0){
+		return;
+	}
+	Message message(emulNet);
+	if(par->PIGGYBACK){
+		// every event goes out PIGGYBACK_LAMBDA * log2(N) times before it is dropped
+		int limit = par->PIGGYBACK_LAMBDA * (int)ceil(log2(memberNode->memberList.size() + 1));
+		MemberEvent *events = scratch.allocArray<MemberEvent>(par->PIGGYBACK_MAX);
+		message.setEvents(events, dissemination.select(par->PIGGYBACK_MAX, limit, events));
+	}
+	switch(type){
+		case PING:
+			message.setPing(memberNode->addr,memberNode->heartbeat);
+			break;
+		case ACK:
+			message.setAck(memberNode->addr,memberNode->heartbeat,subject);
+			break;
+		case PINGREQ:
+			message.setPingReq(memberNode->addr,memberNode->heartbeat,subject);
+			break;
+		case LEAVE:
+			message.setLeave(memberNode->addr,memberNode->heartbeat,subject);
+			break;
+		default:
+			message.setFailed(memberNode->addr,memberNode->heartbeat,subject);
+	}
+	emulNet->ENmulticast(&memberNode->addr, targets, count, message.getBuf(), message.getSize());
+}
+
+/**
+ * the entries worth gossiping, copied to this tick's scratch arena: those silent
+ * for TIMEOUT are about to be removed, stop spreading them so nobody re-adds them
+ * after they were removed. With a base version, only entries changed after it.
+ */
+MemberListEntry *MP1Node::freshEntries(long base, int &count){
+	long now = this->par->getcurrtime();
+	MemberListEntry *fresh = scratch.allocArray<MemberListEntry>((int)memberNode->memberList.size());
+	count = 0;
+	for(int i=0;i<(int)memberNode->memberList.size();i++){
+		MemberListEntry &entry = memberNode->memberList[i];
+		// piggyback mode refreshes no timestamps, and removes members through FAILED and LEAVE events
+		if(!par->PIGGYBACK && now - entry.timestamp >= TIMEOUT){
+			continue;
+		}
+		if(base > 0){
+			// an entry without delta state counts as version 0, without adding a record for it
+			map<int, DeltaState>::iterator it = deltaState.find(entry.id);
+			if(it == deltaState.end() || it->second.version <= base){
+				continue;
+			}
+		}
+		fresh[count++] = entry;
+	}
+	return fresh;
+}
+
+/**
+ * propagate memberlist to all the targets, serialized once and multicast
+ */
+void MP1Node::propagateMemberList(Address *targets, int count){
+	if(count == 0){
+		return;
+	}
+	int entryCount;
+	MemberListEntry *entries = freshEntries(0, entryCount);
+    // send JOINREP message to every target, sharing one payload per fragment
+	sendEntries(JOINREP,targets,count,entries,entryCount,0,0);
+}
+
+/**
+ * propagate to each target the entries that changed since we last gossiped to it.
+ * Targets we sent up to the same version share one payload; targets never sent
+ * to, and every target once per FULL_SYNC_PERIOD, get the full list.
+ */
+void MP1Node::propagateDelta(Address *targets, int count){
+	bool fullSync = par->FULL_SYNC_PERIOD > 0 && memberNode->heartbeat % par->FULL_SYNC_PERIOD == 0;
+	long *bases = scratch.allocArray<long>(count);
+	int *order = scratch.allocArray<int>(count);
+	for(int i=0;i<count;i++){
+		int id = *(int*)(&targets[i].addr);
+		DeltaPeer &peer = deltaPeers[id];
+		bases[i] = fullSync ? 0 : peer.sent;
+		order[i] = i;
+		peer.sent = versionClock;
+	}
+	// group the targets by base version, lowest first
+	stable_sort(order, order + count, [bases](int a, int b){ return bases[a] < bases[b]; });
+	Address *group = scratch.allocArray<Address>(count);
+	int i = 0;
+	while(i < count){
+		long base = bases[order[i]];
+		int members = 0;
+		while(i < count && bases[order[i]] == base){
+			group[members++] = targets[order[i++]];
+		}
+		int entryCount;
+		MemberListEntry *entries = freshEntries(base, entryCount);
+		if(entryCount == 0){
+			continue;
+		}
+		sendEntries(DELTAREP,group,members,entries,entryCount,base,versionClock);
+	}
+}
+
+/**
+ * ask the targets for what we are missing: multicast a digest of our list, split
+ * into DIGEST_RANGES id ranges, and let each target reply with the ranges where it
+ * knows more
+ */
+void MP1Node::propagateDigest(Address *targets, int count){
+	if(count == 0){
+		return;
+	}
+	int ranges = min(par->DIGEST_RANGES, DIGEST_MAX_RANGES);
+	RangeDigest digest[DIGEST_MAX_RANGES];
+	int entryCount;
+	MemberListEntry *entries = freshEntries(0, entryCount);
+	digestOf(entries, entryCount, digest, ranges);
+	// a range with an entry silent for half the timeout asks for all of it
+	long now = this->par->getcurrtime();
+	for(int i=0;i<entryCount;i++){
+		if(now - entries[i].timestamp >= TIMEOUT / 2){
+			digest[(unsigned int)entries[i].id % ranges].beats = 0;
+		}
+	}
+	Message message(emulNet);
+	message.setDigest(memberNode->addr, memberNode->heartbeat, digest, ranges);
+	emulNet->ENmulticast(&memberNode->addr, targets, count, message.getBuf(), message.getSize());
+}
+
+/**
+ * start a tree walk with each target: send the root of our tree, and let the
+ * targets and us take turns descending into the nodes that differ. The leaves
+ * with an entry going silent are named to the targets as well, which answer
+ * with their entries below them; such entries make no node above them differ.
+ */
+void MP1Node::propagateTree(Address *targets, int count){
+	if(count == 0){
+		return;
+	}
+	RangeDigest root = treeSummary(0, 0);
+	Message message(emulNet);
+	message.setTree(memberNode->addr, memberNode->heartbeat, 0, false, &root, 1);
+	emulNet->ENmulticast(&memberNode->addr, targets, count, message.getBuf(), message.getSize());
+	// what does not fit in one message is asked for in the next round
+	int depth = merkle.getDepth();
+	char *stale = staleLeaves();
+	RangeDigest *leaves = scratch.allocArray<RangeDigest>(TREE_MAX_NODES);
+	int silent = 0;
+	for(int i=0;i<merkle.width(depth) && silent < TREE_MAX_NODES;i++){
+		if(stale[i]){
+			leaves[silent++].index = i;
+		}
+	}
+	if(silent > 0){
+		Message ask(emulNet);
+		ask.setSilent(memberNode->addr, memberNode->heartbeat, depth, leaves, silent);
+		emulNet->ENmulticast(&memberNode->addr, targets, count, ask.getBuf(), ask.getSize());
+	}
+}
+
+/**
+ * the summary we send of a tree node
+ */
+RangeDigest MP1Node::treeSummary(int level, int index){
+	merkle_node &node = merkle.at(level, index);
+	RangeDigest summary;
+	summary.hash = node.hash;
+	summary.beats = node.beats;
+	summary.index = index;
+	return summary;
+}
+
+/**
+ * whether the walk goes on below a node the sender summarized as theirs: the
+ * members differ, or the heartbeats are apart by DIGEST_HB_STEP per entry.
+ * Heartbeats that drift by less are left alone.
+ */
+bool MP1Node::treeDiffers(int level, const RangeDigest &theirs){
+	RangeDigest mine = treeSummary(level, theirs.index);
+	if(mine.hash != theirs.hash){
+		return true;
+	}
+	unsigned long step = (unsigned long)(par->DIGEST_HB_STEP * max(merkle.at(level, theirs.index).count, 1));
+	return mine.beats >= theirs.beats + step || theirs.beats >= mine.beats + step;
+}
+
+/**
+ * per leaf of the tree, whether an entry below it was silent for half the
+ * timeout. The leaf is asked for until the entry is removed; only peers that
+ * heard from it lately answer with it, so asking does not keep a failed member
+ * alive. The marks are computed once per tick.
+ */
+char *MP1Node::staleLeaves(){
+	long now = this->par->getcurrtime();
+	if(staleTick != now){
+		staleTick = now;
+		staleMarks.assign(merkle.width(merkle.getDepth()), 0);
+		for(int i=0;i<(int)memberNode->memberList.size();i++){
+			MemberListEntry &entry = memberNode->memberList[i];
+			if(now - entry.timestamp >= TIMEOUT / 2){
+				staleMarks[merkle.leafOf(entry.id)] = 1;
+			}
+		}
+	}
+	return &staleMarks[0];
+}
+
+/**
+ * help function, set the heartbeat of an entry, keeping the tree in step
+ */
+void MP1Node::setHeartbeat(MemberListEntry &entry, long heartbeat){
+	merkle.beat(entry.id, heartbeat - entry.heartbeat);
+	entry.heartbeat = heartbeat;
+}
+
+/**
+ * summarize count entries in ranges digests, an entry going to range id % ranges:
+ * the sum of the hashes of the ids and ports, independent of their order, and the
+ * sum of the heartbeats
+ */
+void MP1Node::digestOf(MemberListEntry *entries, int count, RangeDigest *digest, int ranges){
+	memset(digest, 0, ranges * sizeof(RangeDigest));
+	for(int i=0;i<count;i++){
+		RangeDigest &range = digest[(unsigned int)entries[i].id % ranges];
+		range.hash += MerkleTree::hashOf(entries[i].id, entries[i].port);
+		range.beats += (unsigned long)entries[i].heartbeat;
+	}
+}
+
+/**
+ * multicast entries as a JOINREP or DELTAREP. A list too large for one message
+ * (MAX_MSG_SIZE) is split by id range into numbered fragments, each of which the
+ * receiver merges on its own, so a dropped fragment only loses its own entries.
+ * The entries are sorted in place.
+ */
+void MP1Node::sendEntries(MsgTypes type, Address *targets, int targetCount, MemberListEntry *entries, int count, long base, long upto){
+	// largest payload ENsend accepts
+	size_t limit = par->MAX_MSG_SIZE - sizeof(en_msg) - 1;
+	int fragments = 1;
+	sort(entries, entries + count, compareEntryId);
+
+	while(true){
+		char **bufs = scratch.allocArray<char *>(fragments);
+		size_t *sizes = scratch.allocArray<size_t>(fragments);
+		int per = (count + fragments - 1) / fragments;
+		size_t largest = 0;
+		for(int f=0;f<fragments;f++){
+			int first = min(count, f * per);
+			int last = min(count, first + per);
+			Message message(emulNet);
+			if(type == DELTAREP){
+				message.setDelta(memberNode->addr,memberNode->heartbeat,base,upto,entries + first,last - first,f,fragments);
+			}
+			else{
+				message.setJoinep(memberNode->addr,memberNode->heartbeat,entries + first,last - first,f,fragments);
+			}
+			bufs[f] = message.getBuf();
+			sizes[f] = message.getSize();
+			largest = max(largest, sizes[f]);
+		}
+		if(largest <= limit || per <= 1){
+			for(int f=0;f<fragments;f++){
+				emulNet->ENmulticast(&memberNode->addr, targets, targetCount, bufs[f], sizes[f]);
+			}
+			return;
+		}
+		// too large: give the next try enough fragments for the largest one to fit
+		for(int f=0;f<fragments;f++){
+			emulNet->ENfree(bufs[f]);
+		}
+		fragments = max(fragments + 1, (int)(fragments * largest / limit) + 1);
+	}
+}
+
+/**
+ * FUNCTION NAME: isNullAddress
+ *
+ * DESCRIPTION: Function checks if the address is NULL
+ */
+int MP1Node::isNullAddress(Address *addr) {
+	return (memcmp(addr->addr, NULLADDR, 6) == 0 ? 1 : 0);
+}
+
+/**
+ * FUNCTION NAME: getJoinAddress
+ *
+ * DESCRIPTION: Returns the Address of the introducer to ask on the current join attempt.
+ * 				Introducers are ids 1 to INTRODUCERS; a joiner picks one by hashing its
+ * 				id, then the following ones in turn. Introducer 1 boots the group and
+ * 				the other introducers join it.
+ */
+Address MP1Node::getJoinAddress() {
+    Address joinaddr;
+    int id = *(int*)(&memberNode->addr.addr);
+    int introducer = 1;
+    if( id > par->INTRODUCERS ) {
+    	unsigned int hash = ((unsigned int)id * 2654435761u) >> 16;
+    	introducer = (int)((hash + joinAttempt) % par->INTRODUCERS) + 1;
+    }
+
+    memset(&joinaddr, 0, sizeof(Address));
+    *(int *)(&joinaddr.addr) = introducer;
+    *(short *)(&joinaddr.addr[4]) = 0;
+
+    return joinaddr;
+}
+
+/**
+ * FUNCTION NAME: initMemberListTable
+ *
+ * DESCRIPTION: Initialize the membership list
+ */
+void MP1Node::initMemberListTable(Member *memberNode) {
+	memberTable.attach(&memberNode->memberList);
+	memberTable.clear();
+	ring.clear();
+	merkle.init(par->DIGEST_GOSSIP ? par->MERKLE_DEPTH : 0);
+	// my own entry goes first; nodeLoopOps refreshes it with my heartbeat
+	int id = *(int*)(&memberNode->addr.addr);
+	short port = *(short*)(&memberNode->addr.addr[4]);
+	addEntry(MemberListEntry(id, port, memberNode->heartbeat, par->getcurrtime()));
+	memberNode->myPos = memberNode->memberList.begin();
 }
 
 /**
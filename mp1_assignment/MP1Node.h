@@ -14,14 +14,36 @@
 #include "Member.h"
 #include "EmulNet.h"
 #include "Queue.h"
+#include "WireFormat.h"
+#include "MemberTable.h"
+#include "TimerWheel.h"
+#include "Arena.h"
+#include "Dissemination.h"
+#include "ArrivalWindow.h"
+#include "HashRing.h"
+#include "ChangeFeed.h"
+#include "MerkleTree.h"
 
 /**
  * Macros
  */
 #define TREMOVE 20
 #define TFAIL 5
+// random members a node gossips to per round, unless GOSSIP_FANOUT is set, and a leaving node tells directly
 #define GOSSIPYSIZE 5
 #define TIMEOUT 10
+// ticks a direct SWIM ping waits for its ACK before asking for indirect probes
+#define PING_TIMEOUT 2
+// ticks a joiner waits for its introducer before asking the next one
+#define JOIN_TIMEOUT 5
+// with REGIONS, members that represent their region to the other regions
+#define REGION_REPS 2
+// most id ranges a digest may summarize
+#define DIGEST_MAX_RANGES 64
+// most tree nodes a TREE message may carry
+#define TREE_MAX_NODES 256
+// a differing tree node with fewer entries is sent whole rather than walked into
+#define TREE_DESCEND_ENTRIES 64
 
 /*
  * Note: You can change/add any functions in MP1Node.{h,cpp}
@@ -33,75 +55,439 @@
 enum MsgTypes{
     JOINREQ,
     JOINREP,
+    DELTAREP,
+    SYNCREQ,
+    DIGEST,
+    TREE,
+    PING,
+    ACK,
+    PINGREQ,
+    FAILED,
+    LEAVE,
     DUMMYLASTMSGTYPE
 };
 
 /**
- * STRUCT NAME: MessageHdr
+ * Deadlines kept in the timer wheel, one of each kind per member
+ */
+enum TimerKinds{
+    // heartbeat mode: no newer heartbeat for 2 * TIMEOUT, or until phi reaches
+    // PHI_THRESHOLD, remove the entry
+    REMOVE_TIMER,
+    // SWIM mode: suspected for suspicionTimeout(), confirm the member failed
+    SUSPECT_TIMER,
+    // SWIM mode: failed TREMOVE ago, stop keeping the member out
+    FAILED_TIMER,
+    TIMER_KINDS
+};
+
+/**
+ * Wire format of a message, version WIRE_VERSION. Integers are varints
+ * (see WireFormat.h), so there is no padding and the layout does not
+ * depend on the host:
+ *   byte     WIRE_VERSION
+ *   byte     message type
+ *   varint   sender id
+ *   svarint  sender port
+ *   varint   sender heartbeat
+ *   varint   base version, varint upto version        (DELTAREP only)
+ *   varint   range count, then for each id range:
+ *            fixed32 hash of its ids, varint sum of its heartbeats (DIGEST only)
+ *   varint   tree level, byte 1 if the sender settled the nodes and only wants
+ *            entries back, 2 if they are leaves going silent, varint node count,
+ *            then for each node, sorted by index: varint index minus the previous
+ *            node's index, fixed32 hash, varint sum of its heartbeats; leaves
+ *            going silent have only the index              (TREE only)
+ *   varint   fragment index, varint fragment count    (JOINREP and DELTAREP only)
+ *   varint   subject id, svarint subject port          (PING, ACK, PINGREQ, FAILED and LEAVE only)
+ *   varint   event count, then for each piggybacked event:
+ *            byte type, varint id, svarint port, varint incarnation
+ *                                                      (PING, ACK, PINGREQ, FAILED and LEAVE only)
+ *   varint   entry count, then for each entry, sorted by id:
+ *            varint id minus the previous entry's id, svarint port,
+ *            svarint sender heartbeat minus entry heartbeat (JOINREP and DELTAREP only)
+ * Timestamps are local to each node and never sent.
+ */
+#define WIRE_VERSION 6
+
+// orders entries by node id, the order they are encoded in
+bool compareEntryId(const MemberListEntry &, const MemberListEntry &);
+bool compareEntryIdNewest(const MemberListEntry &, const MemberListEntry &);
+
+/**
+ * STRUCT NAME: RangeDigest
  *
- * DESCRIPTION: Header and content of a message
+ * DESCRIPTION: Summary of the entries of one id range, as sent in a DIGEST, or
+ * 				of one tree node, as sent in a TREE
  */
-typedef struct MessageHdr {
-	enum MsgTypes msgType;
-}MessageHdr;
+typedef struct RangeDigest {
+	// order independent hash of the ids and ports
+	unsigned int hash;
+	// sum of the heartbeats, which only grows as the entries are refreshed
+	unsigned long beats;
+	// index of the node in its tree level (TREE only)
+	int index;
+}RangeDigest;
 
 /**
- * CLASS NAME: MP1Node
+ * STRUCT NAME: DeltaState
  *
- * DESCRIPTION: Class implementing Membership protocol functionalities for failure detection
+ * DESCRIPTION: Delta gossip bookkeeping of one membership entry
+ */
+typedef struct DeltaState {
+	// local version at which the entry last changed
+	long version;
+	// heartbeat the entry had at that version
+	long announced;
+}DeltaState;
+
+/**
+ * STRUCT NAME: DeltaPeer
+ *
+ * DESCRIPTION: Delta gossip bookkeeping of one peer
+ */
+typedef struct DeltaPeer {
+	// version we sent the peer up to, 0 if its next delta must be a full list
+	long sent;
+	// version we received from the peer up to
+	long recv;
+	// version of the fragmented delta being received, and fragments seen of it
+	long pendingUpto;
+	int pendingFrags;
+}DeltaPeer;
+
+/**
+ * CLASS NAME: EntryCursor
+ *
+ * DESCRIPTION: Reads the member list entries of a received message one at a
+ * 				time, straight out of the message buffer
+ */
+class EntryCursor{
+private:
+	WireReader reader;
+	unsigned long left;
+	long heartbeat;
+	int prevId;
+
+public:
+	EntryCursor(WireReader,unsigned long,long);
+	bool next(MemberListEntry &);
+};
+
+/**
+ * CLASS NAME: EventCursor
+ *
+ * DESCRIPTION: Reads the piggybacked events of a received message one at a
+ * 				time, straight out of the message buffer
+ */
+class EventCursor{
+private:
+	WireReader reader;
+	unsigned long left;
+
+public:
+	EventCursor(WireReader,unsigned long);
+	bool next(MemberEvent &);
+};
+
+/**
+ * CLASS NAME: MessageView
+ *
+ * DESCRIPTION: Non-owning, allocation-free decoding of a received message.
+ * 				The whole message is validated up front; the entries are
+ * 				then decoded on demand from the buffer, which must outlive
+ * 				the view.
  */
+class MessageView{
+private:
+	MsgTypes messageType;
+	int id = -1;
+	short port = -1;
+	long heartbeat=-1;
+	long base=-1;
+	long upto=-1;
+	int fragment=0;
+	int fragments=1;
+	int subjectId=0;
+	short subjectPort=0;
+	unsigned long count;
+	// reader positioned at the first entry
+	WireReader entries;
+	unsigned long eventCount;
+	// reader positioned at the first piggybacked event
+	WireReader events;
+	int rangeCount;
+	int level=0;
+	bool settled=false;
+	bool silent=false;
+	// reader positioned at the first digest range or tree node
+	WireReader ranges;
 
+public:
+	MessageView(const char *,size_t size);
+	MsgTypes getMessageType();
+	Address getAddress();
+	int getId();
+	short getPort();
+	long getHeartbeat();
+	long getBase();
+	long getUpto();
+	int getFragment();
+	int getFragments();
+	int getSubjectId();
+	short getSubjectPort();
+	Address getSubject();
+	unsigned long getEntryCount();
+	EntryCursor getEntries();
+	unsigned long getEventCount();
+	EventCursor getEvents();
+	int getRangeCount();
+	int getRanges(RangeDigest *);
+	int getLevel();
+	bool getSettled();
+	bool getSilent();
+};
+
+/**
+ * CLASS NAME: Message
+ *
+ * DESCRIPTION: Encoding and decoding of protocol messages
+ */
 class Message{
 private:
 	char* buf=NULL;
 	size_t size=-1;
 	MsgTypes messageType;
-	Address *address=NULL;
 	int id = -1;
 	short port = -1;
 	long heartbeat=-1;
+	long base=-1;
+	long upto=-1;
+	int fragment=0;
+	int fragments=1;
+	int subjectId=0;
+	short subjectPort=0;
+	// entries of a decoded message, or a sorted copy of those given to a setter
 	vector<MemberListEntry> memberList;
+	// entries encoded into the message
+	const MemberListEntry *entries=NULL;
+	int count=0;
+	// events of a decoded message
+	vector<MemberEvent> eventList;
+	// events piggybacked on the message
+	const MemberEvent *events=NULL;
+	int eventCount=0;
+	// ranges of a decoded digest
+	vector<RangeDigest> rangeList;
+	// ranges encoded into a digest
+	const RangeDigest *ranges=NULL;
+	int rangeCount=0;
+	int level=0;
+	bool settled=false;
+	bool silent=false;
+	// network whose buffer pool backs the messages built here
+	EmulNet *net=NULL;
+	char* allocBuf(size_t size);
+	size_t encode(char*);
+	void build(MsgTypes,Address &,long);
+	void buildProbe(MsgTypes,Address &,long,Address &);
+	void ownEntries(vector<MemberListEntry> &);
 
 public:
 	Message();
+	Message(EmulNet *);
+	// decode a received message into owned fields; the receive path uses MessageView
 	Message(char *,size_t size);
 	//JOINREQ message: JOINREQ, Address, Heartbeat
 	void SetJoiner(Address,long);
-	//JOINREP message: JOINREP,Address,Heartbeat,MemberEntryList
-	void setJoinep(Address,long,vector<MemberListEntry>);
+	//JOINREP message: JOINREP,Address,Heartbeat,fragment,fragments,MemberEntryList
+	void setJoinep(Address,long,vector<MemberListEntry>,int fragment=0,int fragments=1);
+	void setJoinep(Address,long,const MemberListEntry *,int,int,int);
+	//DELTAREP message: DELTAREP,Address,Heartbeat,base version,upto version,fragment,fragments,MemberEntryList
+	void setDelta(Address,long,long,long,vector<MemberListEntry>,int fragment=0,int fragments=1);
+	void setDelta(Address,long,long,long,const MemberListEntry *,int,int,int);
+	//SYNCREQ message: SYNCREQ, Address, Heartbeat
+	void setSyncReq(Address,long);
+	//DIGEST message: DIGEST, Address, Heartbeat, summaries of the id ranges of the sender's list
+	void setDigest(Address,long,const RangeDigest *,int);
+	//TREE message: TREE, Address, Heartbeat, level, settled, summaries of some nodes of that level of the sender's tree
+	void setTree(Address,long,int,bool,const RangeDigest *,int);
+	//TREE message: TREE, Address, Heartbeat, leaf level, the indices of the sender's leaves going silent
+	void setSilent(Address,long,int,const RangeDigest *,int);
+	//PING message: PING, Address, Heartbeat, Address (the sender itself)
+	void setPing(Address,long);
+	//ACK message: ACK, Address, Heartbeat, Address of the node found alive
+	void setAck(Address,long,Address);
+	//PINGREQ message: PINGREQ, Address, Heartbeat, Address of the node to probe
+	void setPingReq(Address,long,Address);
+	//FAILED message: FAILED, Address, Heartbeat, Address of the failed node
+	void setFailed(Address,long,Address);
+	//LEAVE message: LEAVE, Address, Heartbeat, Address of the node that left
+	void setLeave(Address,long,Address);
+	// piggyback count events on the SWIM message built next; they are only read while encoding
+	void setEvents(const MemberEvent *,int);
 
-	// return MessageHdr
+	// decoded fields
 	MsgTypes getMessageType();
-	Address* getAddress();
+	Address getAddress();
 	int getId();
 	short getPort();
 	long getHeartbeat();
-	vector<MemberListEntry> getMemberListEntry();
+	long getBase();
+	long getUpto();
+	int getFragment();
+	int getFragments();
+	int getSubjectId();
+	Address getSubject();
+	vector<MemberListEntry>& getMemberListEntry();
+	vector<MemberEvent>& getEvents();
+	vector<RangeDigest>& getRanges();
+	int getLevel();
+	bool getSettled();
+	bool getSilent();
 	char* getBuf();
 	size_t getSize();
 };
 
+/**
+ * CLASS NAME: MP1Node
+ *
+ * DESCRIPTION: Class implementing Membership protocol functionalities for failure detection
+ */
 class MP1Node {
 private:
 	EmulNet *emulNet;
 	Log *log;
 	Params *par;
 	Member *memberNode;
+	// id index over memberNode->memberList; every insert and remove goes through it
+	MemberTable memberTable;
+	// scratch objects of the current tick, dropped at the end of nodeLoop
+	Arena scratch;
 	char NULLADDR[6];
-	void handleJoinRequest(Message*);
-	void handleGossipyRequest(Message*);
-	void propagateMemberList(MemberListEntry, Member *);
+	void handleJoinRequest(MessageView &);
+	void replyJoiners();
+	void handleGossipyRequest(MessageView &);
+	void handleDelta(MessageView &);
+	void handleSyncRequest(MessageView &);
+	void handleDigest(MessageView &);
+	void handleTree(MessageView &);
+	void handlePing(MessageView &);
+	void handleAck(MessageView &);
+	void handlePingRequest(MessageView &);
+	void handleRemoval(MessageView &);
+	void swimOps();
+	void expireTimers();
+	void refreshEntry(MemberListEntry &);
+	int timerKey(int, TimerKinds);
+	bool isSuspect(int);
+	void clearSuspect(int);
+	bool isFailed(int);
+	void sendProbe(MsgTypes, Address *, int, Address &);
+	void suspectEntry(int);
+	void confirmFailed(int, ChangeTypes);
+	void spreadRemoval(MsgTypes, Address &);
+	void queueEvent(int, int, short, long);
+	void applyEvents(EventCursor);
+	void applyEvent(MemberEvent &);
+	long incarnationOf(int);
+	int suspicionTimeout();
+	MemberListEntry *findEntry(int);
+	MemberListEntry &addEntry(const MemberListEntry &);
+	void removeEntry(int, ChangeTypes);
+	int randomMembers(int, int, Address *);
+	int regionOf(int);
+	bool isLocal(int);
+	bool admitEntry(int);
+	void propagateSummary();
+	void propagateMemberList(Address *, int);
+	void propagateDelta(Address *, int);
+	void propagateDigest(Address *, int);
+	void digestOf(MemberListEntry *, int, RangeDigest *, int);
+	void propagateTree(Address *, int);
+	RangeDigest treeSummary(int, int);
+	bool treeDiffers(int, const RangeDigest &);
+	char *staleLeaves();
+	void setHeartbeat(MemberListEntry &, long);
+	void sendEntries(MsgTypes, Address *, int, MemberListEntry *, int, long, long);
+	void updateMemberList(EntryCursor);
+	void mergeEntry(const MemberListEntry &);
+	void batchEntry(const MemberListEntry &);
+	void mergeBatch();
+	void touchEntry(MemberListEntry &);
+	void forgetEntry(int);
+	MemberListEntry *freshEntries(long, int &);
+	// delta gossip: local version clock, per entry versions, and per peer
+	// the versions sent and received
+	long versionClock;
+	map<int, DeltaState> deltaState;
+	map<int, DeltaPeer> deltaPeers;
+	// SWIM failure detection: probe order of the current round and position in it,
+	// member probed this period, whether it acked, and the origins we relay acks
+	// to per probed id
+	vector<int> probeOrder;
+	int probeNext;
+	int probeTarget;
+	bool probeAcked;
+	map<int, vector<Address> > relays;
+	// introducer: joiners of this tick, answered together once the queue is drained
+	vector<Address> joiners;
+	// joiner: introducers asked so far, and when to ask the next one
+	int joinAttempt;
+	long joinDeadline;
+	// removal, suspicion and failure deadlines of the members
+	TimerWheel timers;
+	// the members in the list, placed on a consistent-hashing ring
+	HashRing ring;
+	// with MERKLE_DEPTH, hash tree over the list, kept up to date on every change
+	MerkleTree merkle;
+	// per tree leaf, whether an entry below it is going silent; computed once per tick
+	vector<char> staleMarks;
+	long staleTick;
+	// with BATCH_MERGE, until the next merge: the highest heartbeat received per
+	// list position, 0 for none, the positions set, and the entries of unknown members
+	vector<long> batchBeats;
+	vector<int> batchSlots;
+	vector<MemberListEntry> batch;
+	// changes of the list, delivered to the listeners once per tick
+	ChangeFeed changes;
+	// with REGIONS: per other region, the sorted ids of its representatives we keep
+	vector<vector<int> > regionReps;
+	// phi detector: heartbeat inter-arrival times of the members
+	map<int, ArrivalWindow> arrivals;
+	// piggyback mode: events waiting to be spread, my incarnation, and the
+	// incarnations we know of the other members
+	Dissemination dissemination;
+	long incarnation;
+	map<int, long> incarnations;
+	// state of my own random choices, seeded from SEED and my id, so that they do
+	// not depend on which thread runs which node
+	unsigned int randSeed;
 
 public:
 	MP1Node(Member *, Params *, EmulNet *, Log *, Address *);
 	Member * getMemberNode() {
 		return memberNode;
 	}
+	HashRing &getRing() {
+		return ring;
+	}
+	MerkleTree &getMerkle() {
+		return merkle;
+	}
+	int subscribe(ChangeCallback callback, void *env) {
+		return changes.subscribe(callback, env);
+	}
+	void unsubscribe(int handle) {
+		changes.unsubscribe(handle);
+	}
 	int recvLoop();
 	static int enqueueWrapper(void *env, char *buff, int size);
 	void nodeStart(char *servaddrstr, short serverport);
 	int initThisNode(Address *joinaddr);
 	int introduceSelfToGroup(Address *joinAddress);
+	void sendJoinRequest(Address *joinaddr);
+	void retryJoin();
 	int finishUpThisNode();
 	void nodeLoop();
 	void checkMessages();
@@ -0,0 +1,160 @@
+/**********************************
+ * FILE NAME: MemberTable.cpp
+ *
+ * DESCRIPTION: Definition of MemberTable class
+ **********************************/
+
+#include "MemberTable.h"
+
+/**
+ * Constructor
+ */
+MemberTable::MemberTable(): entries(NULL), mask(0) {}
+
+/**
+ * FUNCTION NAME: attach
+ *
+ * DESCRIPTION: Index the membership list entries, replacing any previous index
+ */
+void MemberTable::attach(vector<MemberListEntry> *entries) {
+	this->entries = entries;
+	rehash((int)entries->size());
+}
+
+/**
+ * FUNCTION NAME: homeOf
+ *
+ * DESCRIPTION: Return the slot id hashes to. Multiplicative hashing spreads the
+ * 				consecutive ids node addresses get.
+ */
+int MemberTable::homeOf(int id) {
+	return (int)(((unsigned int)id * 2654435761u) >> 8) & mask;
+}
+
+/**
+ * FUNCTION NAME: slotOf
+ *
+ * DESCRIPTION: Return the slot holding id, or the empty slot where it would go
+ */
+int MemberTable::slotOf(int id) {
+	int h = homeOf(id);
+	while ( slots[h] != TABLE_EMPTY && (*entries)[slots[h]].id != id ) {
+		h = (h + 1) & mask;
+	}
+	return h;
+}
+
+/**
+ * FUNCTION NAME: rehash
+ *
+ * DESCRIPTION: Rebuild the index with room for count entries at a load of at most 1/2
+ */
+void MemberTable::rehash(int count) {
+	int n = TABLE_MIN_SLOTS;
+	while ( n < 2 * count ) {
+		n <<= 1;
+	}
+	slots.assign(n, TABLE_EMPTY);
+	mask = n - 1;
+	for ( int i = 0; i < (int)entries->size(); i++ ) {
+		slots[slotOf((*entries)[i].id)] = i;
+	}
+}
+
+/**
+ * FUNCTION NAME: find
+ *
+ * DESCRIPTION: Return the entry of id, NULL if there is none. The pointer is
+ * 				good until the next insert or remove.
+ */
+MemberListEntry *MemberTable::find(int id) {
+	int i = indexOf(id);
+	return i < 0 ? NULL : &(*entries)[i];
+}
+
+/**
+ * FUNCTION NAME: indexOf
+ *
+ * DESCRIPTION: Return the position of id in the list, -1 if it is not there
+ */
+int MemberTable::indexOf(int id) {
+	return slots[slotOf(id)];
+}
+
+/**
+ * FUNCTION NAME: insert
+ *
+ * DESCRIPTION: Add entry, or overwrite the entry with the same id. Returns the stored entry.
+ */
+MemberListEntry &MemberTable::insert(const MemberListEntry &entry) {
+	int h = slotOf(entry.id);
+	if ( slots[h] != TABLE_EMPTY ) {
+		(*entries)[slots[h]] = entry;
+		return (*entries)[slots[h]];
+	}
+	entries->push_back(entry);
+	if ( 2 * (int)entries->size() > (int)slots.size() ) {
+		rehash((int)entries->size());
+	}
+	else {
+		slots[h] = (int)entries->size() - 1;
+	}
+	return entries->back();
+}
+
+/**
+ * FUNCTION NAME: remove
+ *
+ * DESCRIPTION: Remove the entry of id by moving the last entry into its place.
+ * 				Returns false if there was no such entry.
+ */
+bool MemberTable::remove(int id) {
+	int h = slotOf(id);
+	int pos = slots[h];
+	if ( pos == TABLE_EMPTY ) {
+		return false;
+	}
+
+	// backward shift deletion: pull later slots of the probe run into the
+	// hole, so lookups never need tombstones
+	slots[h] = TABLE_EMPTY;
+	int hole = h;
+	int i = (h + 1) & mask;
+	while ( slots[i] != TABLE_EMPTY ) {
+		int home = homeOf((*entries)[slots[i]].id);
+		// move the slot back unless its home lies cyclically in (hole, i]
+		if ( ((i - home) & mask) >= ((i - hole) & mask) ) {
+			slots[hole] = slots[i];
+			slots[i] = TABLE_EMPTY;
+			hole = i;
+		}
+		i = (i + 1) & mask;
+	}
+
+	int last = (int)entries->size() - 1;
+	if ( pos != last ) {
+		slots[slotOf((*entries)[last].id)] = pos;
+		(*entries)[pos] = (*entries)[last];
+	}
+	entries->pop_back();
+	return true;
+}
+
+/**
+ * FUNCTION NAME: clear
+ *
+ * DESCRIPTION: Remove every entry
+ */
+void MemberTable::clear() {
+	entries->clear();
+	rehash(0);
+}
+
+/**
+ * FUNCTION NAME: size
+ *
+ * DESCRIPTION: Return the number of entries
+ */
+int MemberTable::size() {
+	return (int)entries->size();
+}
@@ -0,0 +1,54 @@
+/**********************************
+ * FILE NAME: MemberTable.h
+ *
+ * DESCRIPTION: Header file of MemberTable class
+ **********************************/
+
+#ifndef _MEMBERTABLE_H_
+#define _MEMBERTABLE_H_
+
+#include "stdincludes.h"
+#include "Member.h"
+
+/*
+ * Macros
+ */
+// smallest number of index slots; the slot count is always a power of two
+#define TABLE_MIN_SLOTS 16
+// marks an unused index slot
+#define TABLE_EMPTY -1
+
+/**
+ * CLASS NAME: MemberTable
+ *
+ * DESCRIPTION: Index by node id over a membership list. The entries stay in
+ * 				the list, a dense array that can be iterated as before; the
+ * 				table keeps an open-addressing (linear probing) hash index of
+ * 				their positions. Lookup and insert are O(1), and so is remove,
+ * 				which moves the last entry into the hole. Entries are only
+ * 				ever added and removed through the table, which keeps the
+ * 				index in step with the list. The entry at position 0 is
+ * 				never moved by a removal of another entry.
+ */
+class MemberTable {
+private:
+	vector<MemberListEntry> *entries;
+	// slots[h] is the position in entries of an id hashing near h, or TABLE_EMPTY
+	vector<int> slots;
+	int mask;
+	int homeOf(int id);
+	int slotOf(int id);
+	void rehash(int count);
+public:
+	MemberTable();
+	virtual ~MemberTable() {}
+	void attach(vector<MemberListEntry> *entries);
+	MemberListEntry *find(int id);
+	int indexOf(int id);
+	MemberListEntry &insert(const MemberListEntry &entry);
+	bool remove(int id);
+	void clear();
+	int size();
+};
+
+#endif /* _MEMBERTABLE_H_ */
@@ -0,0 +1,154 @@
+/**********************************
+ * FILE NAME: MerkleTree.cpp
+ *
+ * DESCRIPTION: Definition of MerkleTree class
+ **********************************/
+
+#include "MerkleTree.h"
+
+/**
+ * Constructor
+ */
+MerkleTree::MerkleTree(): depth(0) {}
+
+/**
+ * FUNCTION NAME: init
+ *
+ * DESCRIPTION: Start over as an empty tree of the given depth, at most
+ * 				MERKLE_MAX_DEPTH; 0 turns the tree off
+ */
+void MerkleTree::init(int depth) {
+	this->depth = min(max(depth, 0), MERKLE_MAX_DEPTH);
+	nodes.clear();
+	if ( this->depth > 0 ) {
+		merkle_node empty = { 0, 0, 0 };
+		nodes.assign(offsetOf(this->depth + 1), empty);
+	}
+}
+
+/**
+ * FUNCTION NAME: offsetOf
+ *
+ * DESCRIPTION: Position in nodes of the first node of level
+ */
+int MerkleTree::offsetOf(int level) {
+	int offset = 0;
+	for ( int l = 0; l < level; l++ ) {
+		offset += width(l);
+	}
+	return offset;
+}
+
+/**
+ * FUNCTION NAME: hashOf
+ *
+ * DESCRIPTION: Return the hash an entry adds to the nodes above it
+ */
+unsigned int MerkleTree::hashOf(int id, short port) {
+	unsigned int h = (unsigned int)id * 2654435761u ^ (unsigned short)port;
+	h ^= h >> 15;
+	h *= 0xc2b2ae35u;
+	h ^= h >> 16;
+	return h;
+}
+
+/**
+ * FUNCTION NAME: apply
+ *
+ * DESCRIPTION: Add the given hash, heartbeats and entry count to every node on
+ * 				the path from the leaf of id up to the root
+ */
+void MerkleTree::apply(int id, unsigned int hash, long beats, int count) {
+	int index = leafOf(id);
+	for ( int level = depth; level >= 0; level-- ) {
+		merkle_node &node = nodes[offsetOf(level) + index];
+		node.hash += hash;
+		node.beats += (unsigned long)beats;
+		node.count += count;
+		index /= MERKLE_FANOUT;
+	}
+}
+
+/**
+ * FUNCTION NAME: add
+ *
+ * DESCRIPTION: Account for a new entry
+ */
+void MerkleTree::add(int id, short port, long heartbeat) {
+	if ( depth > 0 ) {
+		apply(id, hashOf(id, port), heartbeat, 1);
+	}
+}
+
+/**
+ * FUNCTION NAME: remove
+ *
+ * DESCRIPTION: Take back an entry added with the same id, port and heartbeat
+ */
+void MerkleTree::remove(int id, short port, long heartbeat) {
+	if ( depth > 0 ) {
+		apply(id, 0u - hashOf(id, port), -heartbeat, -1);
+	}
+}
+
+/**
+ * FUNCTION NAME: beat
+ *
+ * DESCRIPTION: Account for the heartbeat of entry id moving by delta
+ */
+void MerkleTree::beat(int id, long delta) {
+	if ( depth > 0 && delta != 0 ) {
+		apply(id, 0, delta, 0);
+	}
+}
+
+/**
+ * FUNCTION NAME: getDepth
+ *
+ * DESCRIPTION: Return the level of the leaves, 0 when the tree is off
+ */
+int MerkleTree::getDepth() {
+	return depth;
+}
+
+/**
+ * FUNCTION NAME: width
+ *
+ * DESCRIPTION: Return the number of nodes of level
+ */
+int MerkleTree::width(int level) {
+	int width = 1;
+	for ( int l = 0; l < level; l++ ) {
+		width *= MERKLE_FANOUT;
+	}
+	return width;
+}
+
+/**
+ * FUNCTION NAME: leafOf
+ *
+ * DESCRIPTION: Return the index of the leaf holding id
+ */
+int MerkleTree::leafOf(int id) {
+	return (int)((unsigned int)id % (unsigned int)width(depth));
+}
+
+/**
+ * FUNCTION NAME: nodeOf
+ *
+ * DESCRIPTION: Return the index of the node of level above the leaf of id
+ */
+int MerkleTree::nodeOf(int id, int level) {
+	return leafOf(id) / width(depth - level);
+}
+
+/**
+ * FUNCTION NAME: at
+ *
+ * DESCRIPTION: Return the node at index of level. Its children are the nodes
+ * 				index * MERKLE_FANOUT to index * MERKLE_FANOUT + MERKLE_FANOUT - 1
+ * 				of the next level.
+ */
+merkle_node &MerkleTree::at(int level, int index) {
+	return nodes[offsetOf(level) + index];
+}
@@ -0,0 +1,67 @@
+/**********************************
+ * FILE NAME: MerkleTree.h
+ *
+ * DESCRIPTION: Header file of MerkleTree class
+ **********************************/
+
+#ifndef _MERKLETREE_H_
+#define _MERKLETREE_H_
+
+#include "stdincludes.h"
+
+/*
+ * Macros
+ */
+// children of every inner node
+#define MERKLE_FANOUT 16
+// deepest tree supported: MERKLE_FANOUT^MERKLE_MAX_DEPTH leaves
+#define MERKLE_MAX_DEPTH 4
+
+/**
+ * Struct Name: merkle_node
+ *
+ * DESCRIPTION: Summary of the entries below one node of the tree
+ */
+typedef struct merkle_node {
+	// sum of the hashes of the ids and ports, independent of their order
+	unsigned int hash;
+	// sum of the heartbeats
+	unsigned long beats;
+	// number of entries
+	int count;
+}merkle_node;
+
+/**
+ * CLASS NAME: MerkleTree
+ *
+ * DESCRIPTION: Hash tree over a membership list, for reconciling two lists by
+ * 				walking down from the root into the subtrees that differ. The
+ * 				leaves are buckets of ids (id modulo the leaf count) and every
+ * 				node sums up the nodes below it, so adding, removing or
+ * 				refreshing an entry only updates the depth + 1 nodes on its
+ * 				path. Level 0 is the root; a tree of depth 0 keeps nothing
+ * 				and ignores every update.
+ */
+class MerkleTree {
+private:
+	int depth;
+	// the nodes of each level in turn, starting with the root
+	vector<merkle_node> nodes;
+	int offsetOf(int level);
+	void apply(int id, unsigned int hash, long beats, int count);
+public:
+	MerkleTree();
+	virtual ~MerkleTree() {}
+	void init(int depth);
+	static unsigned int hashOf(int id, short port);
+	void add(int id, short port, long heartbeat);
+	void remove(int id, short port, long heartbeat);
+	void beat(int id, long delta);
+	int getDepth();
+	int width(int level);
+	int leafOf(int id);
+	int nodeOf(int id, int level);
+	merkle_node &at(int level, int index);
+};
+
+#endif /* _MERKLETREE_H_ */
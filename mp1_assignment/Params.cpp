@@ -18,6 +18,8 @@ Params::Params(): PORTNUM(8001) {}
  */
 void Params::setparams(char *config_file) {
 	FILE *fp = fopen(config_file,"r");
+	char key[64];
+	double value;
 
 	fscanf(fp,"MAX_NNB: %d", &MAX_NNB);
 	fscanf(fp,"\nSINGLE_FAILURE: %d", &SINGLE_FAILURE);
@@ -26,11 +28,39 @@ void Params::setparams(char *config_file) {
 
 	//printf("Parameters of the test case: %d %d %d %lf\n", MAX_NNB, SINGLE_FAILURE, DROP_MSG, MSG_DROP_PROB);
 
-	EN_GPSZ = MAX_NNB;
 	STEP_RATE=.25;
 	MAX_MSG_SIZE = 4000;
 	globaltime = 0;
 	dropmsg = 0;
+	GRACEFUL_LEAVE = 0;
+	INTRODUCERS = 1;
+	REGIONS = 0;
+	GOSSIP_FANOUT = -1;
+	GOSSIP_PERIOD = 1;
+	DELTA_GOSSIP = 0;
+	FULL_SYNC_PERIOD = 50;
+	DELTA_HB_STEP = 1;
+	DIGEST_GOSSIP = 0;
+	DIGEST_RANGES = 8;
+	DIGEST_HB_STEP = 4;
+	MERKLE_DEPTH = 0;
+	PHI_THRESHOLD = 0;
+	SWIM_DETECTOR = 0;
+	SWIM_PERIOD = 6;
+	SWIM_K = 3;
+	PIGGYBACK = 0;
+	PIGGYBACK_MAX = 6;
+	PIGGYBACK_LAMBDA = 3;
+	BATCH_MERGE = 0;
+	THREADS = 1;
+	SEED = 0;
+
+	// optional "KEY: value" lines may follow, in any order
+	while ( fscanf(fp, " %63[^:]: %lf", key, &value) == 2 ) {
+		setparam(key, value);
+	}
+
+	EN_GPSZ = MAX_NNB;
 	allNodesJoined = 0;
 	for ( unsigned int i = 0; i < EN_GPSZ; i++ ) {
 		allNodesJoined += i;
@@ -39,6 +69,92 @@ void Params::setparams(char *config_file) {
 	return;
 }
 
+/**
+ * FUNCTION NAME: setparam
+ *
+ * DESCRIPTION: Set one optional parameter read from the test case file
+ */
+void Params::setparam(char *key, double value) {
+	if ( strcmp(key, "GOSSIP_FANOUT") == 0 ) {
+		GOSSIP_FANOUT = (int)value;
+	}
+	else if ( strcmp(key, "REGIONS") == 0 ) {
+		REGIONS = max(0, (int)value);
+	}
+	else if ( strcmp(key, "GOSSIP_PERIOD") == 0 ) {
+		GOSSIP_PERIOD = max(1, (int)value);
+	}
+	else if ( strcmp(key, "GRACEFUL_LEAVE") == 0 ) {
+		GRACEFUL_LEAVE = (int)value;
+	}
+	else if ( strcmp(key, "INTRODUCERS") == 0 ) {
+		INTRODUCERS = max(1, (int)value);
+	}
+	else if ( strcmp(key, "STEP_RATE") == 0 ) {
+		STEP_RATE = value;
+	}
+	else if ( strcmp(key, "MAX_MSG_SIZE") == 0 ) {
+		MAX_MSG_SIZE = (int)value;
+	}
+	else if ( strcmp(key, "DELTA_GOSSIP") == 0 ) {
+		DELTA_GOSSIP = (int)value;
+	}
+	else if ( strcmp(key, "FULL_SYNC_PERIOD") == 0 ) {
+		FULL_SYNC_PERIOD = (int)value;
+	}
+	else if ( strcmp(key, "DELTA_HB_STEP") == 0 ) {
+		DELTA_HB_STEP = max(1, (int)value);
+	}
+	else if ( strcmp(key, "DIGEST_GOSSIP") == 0 ) {
+		DIGEST_GOSSIP = (int)value;
+	}
+	else if ( strcmp(key, "DIGEST_RANGES") == 0 ) {
+		DIGEST_RANGES = max(1, (int)value);
+	}
+	else if ( strcmp(key, "DIGEST_HB_STEP") == 0 ) {
+		DIGEST_HB_STEP = max(1, (int)value);
+	}
+	else if ( strcmp(key, "MERKLE_DEPTH") == 0 ) {
+		MERKLE_DEPTH = max(0, (int)value);
+	}
+	else if ( strcmp(key, "PHI_THRESHOLD") == 0 ) {
+		PHI_THRESHOLD = value;
+	}
+	else if ( strcmp(key, "SWIM_DETECTOR") == 0 ) {
+		SWIM_DETECTOR = (int)value;
+	}
+	else if ( strcmp(key, "SWIM_PERIOD") == 0 ) {
+		SWIM_PERIOD = max(1, (int)value);
+	}
+	else if ( strcmp(key, "SWIM_K") == 0 ) {
+		SWIM_K = (int)value;
+	}
+	else if ( strcmp(key, "PIGGYBACK") == 0 ) {
+		PIGGYBACK = (int)value;
+		if ( PIGGYBACK ) {
+			SWIM_DETECTOR = 1;
+		}
+	}
+	else if ( strcmp(key, "PIGGYBACK_MAX") == 0 ) {
+		PIGGYBACK_MAX = max(1, (int)value);
+	}
+	else if ( strcmp(key, "PIGGYBACK_LAMBDA") == 0 ) {
+		PIGGYBACK_LAMBDA = max(1, (int)value);
+	}
+	else if ( strcmp(key, "BATCH_MERGE") == 0 ) {
+		BATCH_MERGE = (int)value;
+	}
+	else if ( strcmp(key, "THREADS") == 0 ) {
+		THREADS = max(1, (int)value);
+	}
+	else if ( strcmp(key, "SEED") == 0 ) {
+		SEED = (int)value;
+	}
+	else {
+		printf("Unknown parameter %s in test case file\n", key);
+	}
+}
+
 /**
  * FUNCTION NAME: getcurrtime
  *
@@ -31,8 +31,31 @@ public:
 	int globaltime;
 	int allNodesJoined;
 	short PORTNUM;
+	int GRACEFUL_LEAVE;			// failing nodes leave with a LEAVE message instead of crashing
+	int INTRODUCERS;			// ids 1 to INTRODUCERS introduce joiners
+	int REGIONS;				// split the members into this many regions, 0 for a flat membership
+	int GOSSIP_FANOUT;			// peers per gossip round, GOSSIPYSIZE unless set; 0 to send to every member
+	int GOSSIP_PERIOD;			// ticks between gossip rounds
+	int DELTA_GOSSIP;			// gossip only the entries that changed since the last exchange
+	int FULL_SYNC_PERIOD;		// in delta mode, ticks between full list exchanges
+	int DELTA_HB_STEP;			// in delta mode, heartbeat progress that makes an entry change
+	int DIGEST_GOSSIP;			// gossip range hashes of the list, and only the ranges that differ in reply
+	int DIGEST_RANGES;			// in digest mode, id ranges a digest is split into
+	int DIGEST_HB_STEP;			// in digest mode, heartbeats a range must be ahead by to be sent
+	int MERKLE_DEPTH;			// in digest mode, reconcile by walking a hash tree of this depth instead of flat ranges; 0 for flat
+	double PHI_THRESHOLD;		// in heartbeat mode, remove a member once its phi reaches this; 0 for the fixed timeout
+	int SWIM_DETECTOR;			// detect failures with SWIM ping / ping-req instead of heartbeat timeouts
+	int SWIM_PERIOD;			// in SWIM mode, ticks per protocol period, one probe each
+	int SWIM_K;					// in SWIM mode, members asked for an indirect probe
+	int PIGGYBACK;				// spread membership events on SWIM messages instead of gossiping lists; implies SWIM_DETECTOR
+	int PIGGYBACK_MAX;			// in piggyback mode, events carried per message
+	int PIGGYBACK_LAMBDA;		// in piggyback mode, an event goes out PIGGYBACK_LAMBDA * log2(N) times
+	int BATCH_MERGE;			// merge the entries received in a tick once, at their highest heartbeat per id
+	int THREADS;				// worker threads running the nodes of a tick; 1 runs them on the main thread
+	int SEED;					// seed of every random choice of the run; 0 to seed from the clock
 	Params();
 	void setparams(char *);
+	void setparam(char *, double);
 	int getcurrtime();
 };
 
@@ -0,0 +1,104 @@
+/**********************************
+ * FILE NAME: ThreadPool.cpp
+ *
+ * DESCRIPTION: Definition of ThreadPool class
+ **********************************/
+
+#include "ThreadPool.h"
+
+// index of the pool worker running on this thread, -1 on any other thread
+static thread_local int current = -1;
+
+/**
+ * Constructor
+ */
+ThreadPool::ThreadPool(): task(NULL), env(NULL), count(0), runs(0), busy(0), stopping(false) {}
+
+/**
+ * Destructor
+ */
+ThreadPool::~ThreadPool() {
+	{
+		lock_guard<mutex> hold(lock);
+		stopping = true;
+	}
+	started.notify_all();
+	for ( unsigned int i = 0; i < workers.size(); i++ ) {
+		workers[i].join();
+	}
+}
+
+/**
+ * FUNCTION NAME: start
+ *
+ * DESCRIPTION: Start threads workers, at most POOL_MAX_THREADS. Called once, before
+ * 				the first run.
+ */
+void ThreadPool::start(int threads) {
+	threads = min(threads, POOL_MAX_THREADS);
+	for ( int i = 0; i < threads; i++ ) {
+		workers.push_back(thread(&ThreadPool::work, this, i));
+	}
+}
+
+/**
+ * FUNCTION NAME: size
+ *
+ * DESCRIPTION: Return the number of workers, 0 before start
+ */
+int ThreadPool::size() {
+	return (int)workers.size();
+}
+
+/**
+ * FUNCTION NAME: run
+ *
+ * DESCRIPTION: Run task over the items 0 to count - 1: worker i gets the i-th
+ * 				of size() contiguous blocks. Returns when all blocks are done.
+ */
+void ThreadPool::run(PoolTask task, void *env, int count) {
+	unique_lock<mutex> hold(lock);
+	this->task = task;
+	this->env = env;
+	this->count = count;
+	busy = (int)workers.size();
+	runs++;
+	started.notify_all();
+	finished.wait(hold, [this]{ return busy == 0; });
+}
+
+/**
+ * FUNCTION NAME: self
+ *
+ * DESCRIPTION: Return the index of the calling worker, -1 when not called from a pool
+ */
+int ThreadPool::self() {
+	return current;
+}
+
+/**
+ * FUNCTION NAME: work
+ *
+ * DESCRIPTION: Loop of worker self: wait for a run, do its block, report it done
+ */
+void ThreadPool::work(int self) {
+	current = self;
+	long done = 0;
+	unique_lock<mutex> hold(lock);
+	while ( true ) {
+		started.wait(hold, [this, done]{ return stopping || runs != done; });
+		if ( stopping ) {
+			return;
+		}
+		done = runs;
+		int threads = (int)workers.size();
+		int begin = (int)((long)count * self / threads);
+		int end = (int)((long)count * (self + 1) / threads);
+		hold.unlock();
+		task(env, begin, end);
+		hold.lock();
+		if ( --busy == 0 ) {
+			finished.notify_one();
+		}
+	}
+}
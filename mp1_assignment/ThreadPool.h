@@ -0,0 +1,53 @@
+/**********************************
+ * FILE NAME: ThreadPool.h
+ *
+ * DESCRIPTION: Header file of ThreadPool class
+ **********************************/
+
+#ifndef _THREADPOOL_H_
+#define _THREADPOOL_H_
+
+#include "stdincludes.h"
+
+/*
+ * Macros
+ */
+// most worker threads a pool starts
+#define POOL_MAX_THREADS 64
+
+// work on the items begin to end - 1 of a run
+typedef void (*PoolTask)(void *env, int begin, int end);
+
+/**
+ * CLASS NAME: ThreadPool
+ *
+ * DESCRIPTION: Fixed set of worker threads running one task at a time. A run
+ * 				splits its items into one contiguous block per worker, in
+ * 				order, and returns once every worker is done with its block,
+ * 				which makes each run a barrier.
+ */
+class ThreadPool {
+private:
+	vector<thread> workers;
+	mutex lock;
+	condition_variable started;
+	condition_variable finished;
+	// task of the current run, and its number of items
+	PoolTask task;
+	void *env;
+	int count;
+	// runs started so far, and workers still busy with the current one
+	long runs;
+	int busy;
+	bool stopping;
+	void work(int self);
+public:
+	ThreadPool();
+	virtual ~ThreadPool();
+	void start(int threads);
+	int size();
+	void run(PoolTask task, void *env, int count);
+	static int self();
+};
+
+#endif /* _THREADPOOL_H_ */
@@ -0,0 +1,168 @@
+/**********************************
+ * FILE NAME: TimerWheel.cpp
+ *
+ * DESCRIPTION: Definition of TimerWheel class
+ **********************************/
+
+#include "TimerWheel.h"
+
+/**
+ * Constructor
+ */
+TimerWheel::TimerWheel(): heads(WHEEL_LEVELS * WHEEL_SLOTS, WHEEL_NONE), current(0) {}
+
+/**
+ * FUNCTION NAME: link
+ *
+ * DESCRIPTION: Put the timer of handle into the slot of its deadline, at the lowest
+ * 				level whose current span holds the deadline
+ */
+void TimerWheel::link(int handle) {
+	wheel_timer &timer = timers[handle];
+	int level = 0;
+	while ( level < WHEEL_LEVELS - 1 && (timer.deadline >> (WHEEL_BITS * (level + 1))) != (current >> (WHEEL_BITS * (level + 1))) ) {
+		level++;
+	}
+	int slot = level * WHEEL_SLOTS + (int)((timer.deadline >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1));
+	timer.slot = slot;
+	timer.prev = WHEEL_NONE;
+	timer.next = heads[slot];
+	if ( heads[slot] != WHEEL_NONE ) {
+		timers[heads[slot]].prev = handle;
+	}
+	heads[slot] = handle;
+}
+
+/**
+ * FUNCTION NAME: unlink
+ *
+ * DESCRIPTION: Take the timer of handle out of its slot
+ */
+void TimerWheel::unlink(int handle) {
+	wheel_timer &timer = timers[handle];
+	if ( timer.prev != WHEEL_NONE ) {
+		timers[timer.prev].next = timer.next;
+	}
+	else {
+		heads[timer.slot] = timer.next;
+	}
+	if ( timer.next != WHEEL_NONE ) {
+		timers[timer.next].prev = timer.prev;
+	}
+	timer.slot = WHEEL_NONE;
+}
+
+/**
+ * FUNCTION NAME: release
+ *
+ * DESCRIPTION: Forget the key of an unlinked timer and keep its handle for reuse
+ */
+void TimerWheel::release(int handle) {
+	handles.erase(timers[handle].key);
+	freeHandles.push_back(handle);
+}
+
+/**
+ * FUNCTION NAME: schedule
+ *
+ * DESCRIPTION: Set the deadline of key, replacing any earlier one.
+ * 				A deadline that already passed fires on the next tick.
+ */
+void TimerWheel::schedule(int key, long deadline) {
+	int handle;
+	unordered_map<int, int>::iterator it = handles.find(key);
+	if ( it != handles.end() ) {
+		handle = it->second;
+		unlink(handle);
+	}
+	else {
+		if ( freeHandles.empty() ) {
+			wheel_timer unused = { 0, 0, WHEEL_NONE, WHEEL_NONE, WHEEL_NONE };
+			freeHandles.push_back((int)timers.size());
+			timers.push_back(unused);
+		}
+		handle = freeHandles.back();
+		freeHandles.pop_back();
+		timers[handle].key = key;
+		handles[key] = handle;
+	}
+	timers[handle].deadline = max(deadline, current + 1);
+	link(handle);
+}
+
+/**
+ * FUNCTION NAME: cancel
+ *
+ * DESCRIPTION: Drop the deadline of key, if it has one
+ */
+void TimerWheel::cancel(int key) {
+	unordered_map<int, int>::iterator it = handles.find(key);
+	if ( it != handles.end() ) {
+		int handle = it->second;
+		unlink(handle);
+		release(handle);
+	}
+}
+
+/**
+ * FUNCTION NAME: pending
+ *
+ * DESCRIPTION: Return true if key has a deadline that has not fired yet
+ */
+bool TimerWheel::pending(int key) {
+	return handles.count(key) > 0;
+}
+
+/**
+ * FUNCTION NAME: deadline
+ *
+ * DESCRIPTION: Return the deadline of a pending key
+ */
+long TimerWheel::deadline(int key) {
+	return timers[handles[key]].deadline;
+}
+
+/**
+ * FUNCTION NAME: cascade
+ *
+ * DESCRIPTION: Move the timers of the level slot the current tick just entered
+ * 				down to the lower levels
+ */
+void TimerWheel::cascade(int level) {
+	int slot = level * WHEEL_SLOTS + (int)((current >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1));
+	int handle = heads[slot];
+	heads[slot] = WHEEL_NONE;
+	while ( handle != WHEEL_NONE ) {
+		int next = timers[handle].next;
+		link(handle);
+		handle = next;
+	}
+}
+
+/**
+ * FUNCTION NAME: advance
+ *
+ * DESCRIPTION: Move the wheel forward to tick now, one tick at a time. The keys
+ * 				whose deadline passed are appended to due and are no longer pending.
+ */
+void TimerWheel::advance(long now, vector<int> &due) {
+	while ( current < now ) {
+		current++;
+		// entering a new span of a level: spread its slot over the levels below
+		for ( int level = WHEEL_LEVELS - 1; level > 0; level-- ) {
+			if ( (current & ((1L << (WHEEL_BITS * level)) - 1)) == 0 ) {
+				cascade(level);
+			}
+		}
+		int slot = (int)(current & (WHEEL_SLOTS - 1));
+		int handle = heads[slot];
+		heads[slot] = WHEEL_NONE;
+		while ( handle != WHEEL_NONE ) {
+			int next = timers[handle].next;
+			timers[handle].slot = WHEEL_NONE;
+			due.push_back(timers[handle].key);
+			release(handle);
+			handle = next;
+		}
+	}
+}
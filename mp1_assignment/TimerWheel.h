@@ -0,0 +1,70 @@
+/**********************************
+ * FILE NAME: TimerWheel.h
+ *
+ * DESCRIPTION: Header file of TimerWheel class
+ **********************************/
+
+#ifndef _TIMERWHEEL_H_
+#define _TIMERWHEEL_H_
+
+#include "stdincludes.h"
+
+/*
+ * Macros
+ */
+// slots per level are 1 << WHEEL_BITS; level l slots are 64^l ticks wide
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+#define WHEEL_LEVELS 4
+// end of a slot list, and the slot of a timer that is not scheduled
+#define WHEEL_NONE -1
+
+/**
+ * Struct Name: wheel_timer
+ *
+ * DESCRIPTION: Deadline of one key, linked into the list of its wheel slot
+ */
+typedef struct wheel_timer {
+	int key;
+	long deadline;
+	// slot the timer is linked into, WHEEL_NONE if it is not scheduled
+	int slot;
+	int prev;
+	int next;
+}wheel_timer;
+
+/**
+ * CLASS NAME: TimerWheel
+ *
+ * DESCRIPTION: Hierarchical timing wheel holding at most one deadline per key.
+ * 				Keys are non-negative integers, such as node ids; storage
+ * 				follows the pending timers, not the largest key.
+ * 				Scheduling, rescheduling and cancelling are O(1). Advancing
+ * 				one tick only touches the timers due in that tick, plus a
+ * 				cascade of one higher level slot every 64 ticks.
+ */
+class TimerWheel {
+private:
+	// timers by handle; slot lists are linked through prev / next handles
+	vector<wheel_timer> timers;
+	// handles of the pending timers by key, and handles free for reuse
+	unordered_map<int, int> handles;
+	vector<int> freeHandles;
+	vector<int> heads;
+	// last tick advanced to
+	long current;
+	void link(int handle);
+	void unlink(int handle);
+	void release(int handle);
+	void cascade(int level);
+public:
+	TimerWheel();
+	virtual ~TimerWheel() {}
+	void schedule(int key, long deadline);
+	void cancel(int key);
+	bool pending(int key);
+	long deadline(int key);
+	void advance(long now, vector<int> &due);
+};
+
+#endif /* _TIMERWHEEL_H_ */
@@ -0,0 +1,1629 @@
+/**********************************
+ * FILE NAME: UnitTest.cpp
+ *
+ * DESCRIPTION: Definition of UnitTest class
+ **********************************/
+
+#include "UnitTest.h"
+
+/**
+ * Constructor
+ */
+UnitTest::UnitTest(): failures(0) {}
+
+/**
+ * FUNCTION NAME: check
+ *
+ * DESCRIPTION: Record a failure when cond does not hold
+ */
+void UnitTest::check(bool cond, const char *what) {
+	if ( !cond ) {
+		printf("FAIL: %s\n", what);
+		failures++;
+	}
+}
+
+/**
+ * FUNCTION NAME: run
+ *
+ * DESCRIPTION: Run every test. Returns the number of failed checks.
+ */
+int UnitTest::run() {
+	Test_Mailbox();
+	Test_MsgCounter();
+	Test_BufferPool();
+	Test_Multicast();
+	Test_Message();
+	Test_MessageSize();
+	Test_MemberTable();
+	Test_TimerWheel();
+	Test_Arena();
+	Test_Dissemination();
+	Test_ArrivalWindow();
+	Test_HashRing();
+	Test_ChangeFeed();
+	Test_MerkleTree();
+	Test_BatchMerge();
+	Test_ThreadPool();
+	Test_Delta();
+	Test_Fragments();
+	Test_Swim();
+	Test_Digest();
+	Test_JoinBatch();
+	Test_Introducers();
+	Test_Regions();
+	printf("%s: %d failed checks\n", failures ? "FAILED" : "PASSED", failures);
+	return failures;
+}
+
+/**
+ * Receive callback of the network tests: env is the vector the messages go to
+ */
+static int collectMsg(void *env, char *buf, int size) {
+	((vector<q_elt> *)env)->push_back(q_elt(buf, size));
+	return 0;
+}
+
+/**
+ * FUNCTION NAME: Test_Mailbox
+ *
+ * DESCRIPTION: A receive only gets the messages sent to the receiver, and a
+ * 				message the network drops reaches nobody
+ */
+void UnitTest::Test_Mailbox() {
+	Params par;
+	par.setparams((char *)"testcases/multifailure.conf");
+	par.globaltime = 1;
+	EmulNet net(&par);
+	Address addr[3];
+	for ( int k = 0; k < 3; k++ ) {
+		net.ENinit(&addr[k], par.PORTNUM);
+	}
+
+	// every node sends 10 * its index + d to the node d places further
+	for ( int k = 0; k < 3; k++ ) {
+		for ( int d = 1; d <= 2; d++ ) {
+			int payload = 10 * k + d;
+			net.ENsend(&addr[k], &addr[(k + d) % 3], (char *)&payload, sizeof(payload));
+		}
+	}
+	bool delivered = true;
+	for ( int k = 0; k < 3; k++ ) {
+		vector<q_elt> got;
+		net.ENrecv(&addr[k], collectMsg, NULL, 1, &got);
+		delivered = delivered && got.size() == 2;
+		for ( unsigned int i = 0; i < got.size(); i++ ) {
+			int payload = *(int *)got[i].elt;
+			delivered = delivered && got[i].size == sizeof(payload) && (payload / 10 + payload % 10) % 3 == k;
+			net.ENfree((char *)got[i].elt);
+		}
+		got.clear();
+		net.ENrecv(&addr[k], collectMsg, NULL, 1, &got);
+		delivered = delivered && got.empty();
+	}
+	check(delivered, "each node receives exactly the messages sent to it, once");
+
+	// dropped and oversized messages are not enqueued, and their buffer goes back to the pool
+	int payload = 1;
+	par.dropmsg = 1;
+	par.MSG_DROP_PROB = 1;
+	char *buf = net.ENalloc(sizeof(payload));
+	check(net.ENsendbuf(&addr[0], &addr[1], buf, sizeof(payload)) == 0, "dropped send returns 0");
+	par.dropmsg = 0;
+	char *big = net.ENalloc(par.MAX_MSG_SIZE);
+	check(net.ENsendbuf(&addr[0], &addr[1], big, par.MAX_MSG_SIZE) == 0, "oversized send returns 0");
+	vector<q_elt> got;
+	net.ENrecv(&addr[1], collectMsg, NULL, 1, &got);
+	check(got.empty(), "dropped messages are not received");
+	char *again = net.ENalloc(sizeof(payload));
+	check(again == buf, "buffer of a dropped message is released");
+	net.ENfree(again);
+}
+
+/**
+ * FUNCTION NAME: Test_MsgCounter
+ *
+ * DESCRIPTION: Counts land on the right tick whatever order the ticks come in,
+ * 				and only the span between the first and last one is stored
+ */
+void UnitTest::Test_MsgCounter() {
+	MsgCounter counter;
+	check(counter.first == -1 && counter.get(0) == 0, "empty counter");
+
+	counter.add(5);
+	counter.add(5);
+	counter.add(9);
+	check(counter.first == 5 && counter.count.size() == 5, "span from the first tick");
+	// earlier than the first tick: the span grows in front
+	counter.add(2);
+	counter.add(7);
+	counter.add(2);
+	check(counter.first == 2 && counter.count.size() == 8, "span grown in front");
+	check(counter.get(2) == 2 && counter.get(5) == 2 && counter.get(7) == 1 && counter.get(9) == 1, "counts kept on their tick");
+	check(counter.get(3) == 0 && counter.get(1) == 0 && counter.get(10) == 0, "ticks without messages");
+}
+
+/**
+ * FUNCTION NAME: Test_BufferPool
+ *
+ * DESCRIPTION: A released buffer is handed out again for its size class,
+ * 				and only once its last reference is dropped
+ */
+void UnitTest::Test_BufferPool() {
+	BufferPool pool;
+	char *a = pool.alloc(100);
+	char *b = pool.alloc(100);
+	char *small = pool.alloc(10);
+	check(a != b && a != small && b != small, "live buffers are distinct");
+	memset(a, 1, 100);
+	memset(b, 2, 100);
+	check(a[99] == 1 && b[0] == 2, "live buffers do not overlap");
+
+	pool.release(a);
+	check(pool.alloc(120) == a, "released buffer reused within its size class");
+	pool.release(small);
+	char *other = pool.alloc(100);
+	check(other != small, "released buffer not reused for a larger class");
+
+	pool.retain(b, 2);
+	pool.release(b);
+	pool.release(b);
+	char *c = pool.alloc(100);
+	check(c != b, "buffer kept while references remain");
+	pool.release(b);
+	check(pool.alloc(100) == b, "buffer reused after its last reference");
+
+	// too large for the slabs: allocated and freed on its own
+	char *big = pool.alloc(100000);
+	memset(big, 3, 100000);
+	pool.release(big);
+
+	pool.release(a);
+	pool.release(b);
+	pool.release(c);
+	pool.release(other);
+}
+
+/**
+ * FUNCTION NAME: Test_Multicast
+ *
+ * DESCRIPTION: Every receiver of a multicast gets the one payload, which goes
+ * 				back to the pool only after the last receiver is done with it
+ */
+void UnitTest::Test_Multicast() {
+	Params par;
+	par.setparams((char *)"testcases/multifailure.conf");
+	par.globaltime = 1;
+	EmulNet net(&par);
+	Address addr[4];
+	for ( int k = 0; k < 4; k++ ) {
+		net.ENinit(&addr[k], par.PORTNUM);
+	}
+
+	char *buf = net.ENalloc(64);
+	strcpy(buf, "shared");
+	check(net.ENmulticast(&addr[0], &addr[1], 3, buf, 64) == 3, "multicast sent to every destination");
+	vector<q_elt> got;
+	for ( int k = 1; k < 4; k++ ) {
+		net.ENrecv(&addr[k], collectMsg, NULL, 1, &got);
+	}
+	bool shared = got.size() == 3;
+	for ( unsigned int i = 0; shared && i < got.size(); i++ ) {
+		shared = got[i].elt == buf && got[i].size == 64;
+	}
+	check(shared, "every receiver gets the one payload");
+
+	bool kept = true;
+	for ( unsigned int i = 0; i + 1 < got.size(); i++ ) {
+		net.ENfree((char *)got[i].elt);
+		char *probe = net.ENalloc(64);
+		kept = kept && probe != buf && strcmp(buf, "shared") == 0;
+		net.ENfree(probe);
+	}
+	check(kept, "payload kept until the last receiver frees it");
+	net.ENfree((char *)got.back().elt);
+	char *probe = net.ENalloc(64);
+	check(probe == buf, "payload released after the last receiver");
+
+	// all destinations dropped: the sender's reference was the last one
+	par.dropmsg = 1;
+	par.MSG_DROP_PROB = 1;
+	check(net.ENmulticast(&addr[0], &addr[1], 3, probe, 64) == 0, "dropped multicast reaches nobody");
+	par.dropmsg = 0;
+	char *again = net.ENalloc(64);
+	check(again == buf, "payload of a dropped multicast released");
+	net.ENfree(again);
+}
+
+/**
+ * FUNCTION NAME: Test_Message
+ *
+ * DESCRIPTION: Encode / decode round trip of every message type
+ */
+void UnitTest::Test_Message() {
+	Address sender;
+	sender.init();
+	*(int *)(&sender.addr) = 7;
+	*(short *)(&sender.addr[4]) = 8001;
+	long heartbeat = 1000;
+
+	// unsorted ids, ports of both signs, heartbeats around the sender's
+	vector<MemberListEntry> entries;
+	for ( int i = 0; i < 200; i++ ) {
+		int id = (i * 37) % 200 + 1;
+		entries.push_back(MemberListEntry(id, (short)(i % 3 - 1), heartbeat - 100 + (i * 13) % 250, 42));
+	}
+
+	Message join;
+	join.SetJoiner(sender, heartbeat);
+	Message joinIn(join.getBuf(), join.getSize());
+	check(joinIn.getMessageType() == JOINREQ, "JOINREQ type");
+	check(joinIn.getId() == 7 && joinIn.getPort() == 8001, "JOINREQ sender");
+	check(joinIn.getHeartbeat() == heartbeat, "JOINREQ heartbeat");
+	check(joinIn.getAddress() == sender, "JOINREQ address");
+
+	Message rep;
+	rep.setJoinep(sender, heartbeat, entries);
+	Message repIn(rep.getBuf(), rep.getSize());
+	vector<MemberListEntry> decoded = repIn.getMemberListEntry();
+	vector<MemberListEntry> expected = entries;
+	sort(expected.begin(), expected.end(), compareEntryId);
+	check(repIn.getMessageType() == JOINREP, "JOINREP type");
+	check(decoded.size() == expected.size(), "JOINREP entry count");
+	bool same = decoded.size() == expected.size();
+	for ( unsigned int i = 0; same && i < decoded.size(); i++ ) {
+		same = decoded[i].id == expected[i].id && decoded[i].port == expected[i].port && decoded[i].heartbeat == expected[i].heartbeat;
+	}
+	check(same, "JOINREP entries");
+
+	// the view decodes the same entries in place
+	MessageView repView(rep.getBuf(), rep.getSize());
+	EntryCursor cursor = repView.getEntries();
+	MemberListEntry viewed;
+	unsigned int n = 0;
+	same = repView.getMessageType() == JOINREP && repView.getEntryCount() == expected.size();
+	while ( cursor.next(viewed) ) {
+		same = same && n < expected.size() && viewed.id == expected[n].id && viewed.port == expected[n].port && viewed.heartbeat == expected[n].heartbeat;
+		n++;
+	}
+	check(same && n == expected.size(), "view entries");
+
+	Message delta;
+	delta.setDelta(sender, heartbeat, 12, 345, vector<MemberListEntry>(entries.begin(), entries.begin() + 3));
+	Message deltaIn(delta.getBuf(), delta.getSize());
+	check(deltaIn.getMessageType() == DELTAREP, "DELTAREP type");
+	check(deltaIn.getBase() == 12 && deltaIn.getUpto() == 345, "DELTAREP versions");
+	check(deltaIn.getMemberListEntry().size() == 3, "DELTAREP entry count");
+	check(deltaIn.getFragment() == 0 && deltaIn.getFragments() == 1, "DELTAREP unfragmented");
+
+	Message frag;
+	frag.setJoinep(sender, heartbeat, vector<MemberListEntry>(entries.begin(), entries.begin() + 5), 2, 5);
+	Message fragIn(frag.getBuf(), frag.getSize());
+	check(fragIn.getFragment() == 2 && fragIn.getFragments() == 5, "JOINREP fragment numbers");
+	check(fragIn.getMemberListEntry().size() == 5, "JOINREP fragment entries");
+
+	Message sync;
+	sync.setSyncReq(sender, heartbeat);
+	Message syncIn(sync.getBuf(), sync.getSize());
+	check(syncIn.getMessageType() == SYNCREQ && syncIn.getHeartbeat() == heartbeat, "SYNCREQ");
+
+	RangeDigest ranges[3] = { { 0xdeadbeefu, 0 }, { 0, 123456789 }, { 7, 1 } };
+	Message digest;
+	digest.setDigest(sender, heartbeat, ranges, 3);
+	Message digestIn(digest.getBuf(), digest.getSize());
+	vector<RangeDigest> &summed = digestIn.getRanges();
+	same = digestIn.getMessageType() == DIGEST && digestIn.getId() == 7 && summed.size() == 3;
+	for ( unsigned int i = 0; same && i < summed.size(); i++ ) {
+		same = summed[i].hash == ranges[i].hash && summed[i].beats == ranges[i].beats;
+	}
+	check(same, "DIGEST ranges");
+	check(digest.getSize() < 30, "DIGEST stays small");
+	// the range count is the byte before the ranges: 3 hashes and 1 + 4 + 1 bytes of beats
+	digest.getBuf()[digest.getSize() - (3 * 4 + 1 + 4 + 1) - 1] = DIGEST_MAX_RANGES + 1;
+	MessageView badDigest(digest.getBuf(), digest.getSize());
+	check(badDigest.getMessageType() == DUMMYLASTMSGTYPE, "too many digest ranges rejected");
+
+	RangeDigest nodes[3] = { { 0xdeadbeefu, 0, 3 }, { 0, 123456789, 4 }, { 7, 1, 200 } };
+	Message tree;
+	tree.setTree(sender, heartbeat, 2, true, nodes, 3);
+	Message treeIn(tree.getBuf(), tree.getSize());
+	vector<RangeDigest> &walked = treeIn.getRanges();
+	same = treeIn.getMessageType() == TREE && treeIn.getLevel() == 2 && treeIn.getSettled() && walked.size() == 3;
+	for ( unsigned int i = 0; same && i < walked.size(); i++ ) {
+		same = walked[i].hash == nodes[i].hash && walked[i].beats == nodes[i].beats && walked[i].index == nodes[i].index;
+	}
+	check(same, "TREE nodes");
+	Message silent;
+	silent.setSilent(sender, heartbeat, 2, nodes, 3);
+	Message silentIn(silent.getBuf(), silent.getSize());
+	vector<RangeDigest> &named = silentIn.getRanges();
+	same = silentIn.getMessageType() == TREE && silentIn.getSettled() && silentIn.getSilent() && named.size() == 3;
+	for ( unsigned int i = 0; same && i < named.size(); i++ ) {
+		same = named[i].index == nodes[i].index && named[i].hash == 0 && named[i].beats == 0;
+	}
+	check(same, "TREE leaves going silent");
+	check(silent.getSize() < tree.getSize() - 3 * 4, "leaves going silent carry no summaries");
+	// node 200 does not exist on level 1, which has MERKLE_FANOUT nodes
+	Message wide;
+	wide.setTree(sender, heartbeat, 1, false, nodes, 3);
+	MessageView badLevel(wide.getBuf(), wide.getSize());
+	check(badLevel.getMessageType() == DUMMYLASTMSGTYPE, "tree node past its level rejected");
+	nodes[1].index = 3;
+	Message repeated;
+	repeated.setTree(sender, heartbeat, 2, false, nodes, 3);
+	MessageView badOrder(repeated.getBuf(), repeated.getSize());
+	check(badOrder.getMessageType() == DUMMYLASTMSGTYPE, "repeated tree node rejected");
+
+	Address subject;
+	subject.init();
+	*(int *)(&subject.addr) = 42;
+	*(short *)(&subject.addr[4]) = -3;
+	Message ping;
+	ping.setPing(sender, heartbeat);
+	Message pingIn(ping.getBuf(), ping.getSize());
+	check(pingIn.getMessageType() == PING && pingIn.getSubject() == sender, "PING");
+	Message ack;
+	ack.setAck(sender, heartbeat, subject);
+	Message ackIn(ack.getBuf(), ack.getSize());
+	check(ackIn.getMessageType() == ACK && ackIn.getSubjectId() == 42 && ackIn.getSubject() == subject, "ACK subject");
+	Message pingReq;
+	pingReq.setPingReq(sender, heartbeat, subject);
+	Message pingReqIn(pingReq.getBuf(), pingReq.getSize());
+	check(pingReqIn.getMessageType() == PINGREQ && pingReqIn.getSubject() == subject, "PINGREQ subject");
+	Message failedMsg;
+	failedMsg.setFailed(sender, heartbeat, subject);
+	Message failedIn(failedMsg.getBuf(), failedMsg.getSize());
+	check(failedIn.getMessageType() == FAILED && failedIn.getSubject() == subject, "FAILED subject");
+	Message leave;
+	leave.setLeave(sender, heartbeat, subject);
+	Message leaveIn(leave.getBuf(), leave.getSize());
+	check(leaveIn.getMessageType() == LEAVE && leaveIn.getSubject() == subject, "LEAVE subject");
+
+	// piggybacked events ride on the SWIM messages
+	MemberEvent events[3];
+	for ( int i = 0; i < 3; i++ ) {
+		events[i].type = i;
+		events[i].id = 100 + i;
+		events[i].port = (short)(i - 1);
+		events[i].incarnation = 5 * i;
+	}
+	Message gossip;
+	gossip.setEvents(events, 3);
+	gossip.setAck(sender, heartbeat, subject);
+	Message gossipIn(gossip.getBuf(), gossip.getSize());
+	vector<MemberEvent> &carried = gossipIn.getEvents();
+	same = gossipIn.getMessageType() == ACK && gossipIn.getSubject() == subject && carried.size() == 3;
+	for ( unsigned int i = 0; same && i < carried.size(); i++ ) {
+		same = carried[i].type == events[i].type && carried[i].id == events[i].id && carried[i].port == events[i].port && carried[i].incarnation == events[i].incarnation;
+	}
+	check(same, "ACK events");
+	MessageView gossipView(gossip.getBuf(), gossip.getSize());
+	check(gossipView.getEventCount() == 3 && ackIn.getEvents().empty(), "event count");
+	gossip.getBuf()[gossip.getSize() - 4] = DUMMYLASTEVENTTYPE;
+	MessageView badEvent(gossip.getBuf(), gossip.getSize());
+	check(badEvent.getMessageType() == DUMMYLASTMSGTYPE, "unknown event type rejected");
+
+	// truncated, padded and wrong version messages are rejected
+	Message cut(rep.getBuf(), rep.getSize() - 1);
+	check(cut.getMessageType() == DUMMYLASTMSGTYPE && cut.getMemberListEntry().empty(), "truncated message rejected");
+	MessageView cutView(rep.getBuf(), rep.getSize() - 1);
+	check(cutView.getMessageType() == DUMMYLASTMSGTYPE && !cutView.getEntries().next(viewed), "truncated view has no entries");
+	char *padded = (char *) malloc(rep.getSize() + 1);
+	memcpy(padded, rep.getBuf(), rep.getSize());
+	padded[rep.getSize()] = 0;
+	Message pad(padded, rep.getSize() + 1);
+	check(pad.getMessageType() == DUMMYLASTMSGTYPE, "trailing bytes rejected");
+	padded[0] = WIRE_VERSION + 1;
+	Message old(padded, rep.getSize());
+	check(old.getMessageType() == DUMMYLASTMSGTYPE, "unknown version rejected");
+
+	free(padded);
+	free(join.getBuf());
+	free(rep.getBuf());
+	free(delta.getBuf());
+	free(frag.getBuf());
+	free(sync.getBuf());
+	free(digest.getBuf());
+	free(tree.getBuf());
+	free(silent.getBuf());
+	free(wide.getBuf());
+	free(repeated.getBuf());
+	free(ping.getBuf());
+	free(ack.getBuf());
+	free(pingReq.getBuf());
+	free(failedMsg.getBuf());
+	free(leave.getBuf());
+	free(gossip.getBuf());
+}
+
+/**
+ * FUNCTION NAME: Test_MessageSize
+ *
+ * DESCRIPTION: Compare the JOINREP size against the old raw struct encoding
+ * 				({int type, char[6] address, long heartbeat, 24 B per entry})
+ * 				for steady-state lists, where heartbeats trail the sender's by a few ticks
+ */
+void UnitTest::Test_MessageSize() {
+	int sizes[] = { 100, 1000, 10000 };
+	Address sender;
+	sender.init();
+	*(int *)(&sender.addr) = 1;
+	long heartbeat = 5000;
+
+	for ( int s = 0; s < 3; s++ ) {
+		int n = sizes[s];
+		vector<MemberListEntry> entries;
+		for ( int id = 1; id <= n; id++ ) {
+			entries.push_back(MemberListEntry(id, 0, heartbeat - id % 20, 0));
+		}
+		size_t raw = 4 + 6 + sizeof(long) + 24 * (size_t)n;
+
+		Message rep;
+		rep.setJoinep(sender, heartbeat, entries);
+		printf("JOINREP with %5d entries: raw %7lu B, packed %6lu B (%.1f B/entry)\n",
+				n, (unsigned long)raw, (unsigned long)rep.getSize(), (double)rep.getSize() / n);
+		check(rep.getSize() * 4 < raw, "packed JOINREP at least 4x smaller");
+
+		Message repIn(rep.getBuf(), rep.getSize());
+		check(repIn.getMemberListEntry().size() == (size_t)n, "large JOINREP round trip");
+		free(rep.getBuf());
+	}
+}
+
+/**
+ * FUNCTION NAME: Test_MemberTable
+ *
+ * DESCRIPTION: Random inserts, updates and removes against a std::map model;
+ * 				the id index must always agree with the list it covers
+ */
+void UnitTest::Test_MemberTable() {
+	vector<MemberListEntry> list;
+	MemberTable table;
+	table.attach(&list);
+	map<int, long> model;
+
+	srand(1);
+	for ( int step = 0; step < 20000; step++ ) {
+		int id = rand() % 500 + 1;
+		if ( rand() % 3 ) {
+			table.insert(MemberListEntry(id, 0, step, 0));
+			model[id] = step;
+		}
+		else {
+			check(table.remove(id) == (model.erase(id) == 1), "remove reports presence");
+		}
+	}
+	check(table.size() == (int)model.size(), "table size");
+	bool same = true;
+	for ( int id = 1; id <= 500; id++ ) {
+		MemberListEntry *entry = table.find(id);
+		map<int, long>::iterator it = model.find(id);
+		if ( it == model.end() ) {
+			same = same && entry == NULL;
+		}
+		else {
+			same = same && entry != NULL && entry->id == id && entry->heartbeat == it->second;
+		}
+	}
+	check(same, "lookups match the model");
+	for ( int i = 0; i < (int)list.size(); i++ ) {
+		same = same && table.indexOf(list[i].id) == i;
+	}
+	check(same, "index matches list positions");
+
+	// the entry at position 0, a node's own entry, stays put
+	list.clear();
+	table.attach(&list);
+	for ( int id = 1; id <= 100; id++ ) {
+		table.insert(MemberListEntry(id, 0));
+	}
+	for ( int id = 2; id <= 100; id += 2 ) {
+		table.remove(id);
+	}
+	check(list[0].id == 1 && table.size() == 50, "first entry kept by removals");
+}
+
+/**
+ * FUNCTION NAME: Test_TimerWheel
+ *
+ * DESCRIPTION: Random schedules, reschedules and cancels, with deadlines from
+ * 				one tick to past the second level; every key must fire exactly
+ * 				at its last deadline, and cancelled keys never
+ */
+void UnitTest::Test_TimerWheel() {
+	TimerWheel wheel;
+	// expected deadline per key, -1 when not scheduled
+	vector<long> expected(300, -1);
+	bool exact = true;
+	vector<int> due;
+
+	srand(2);
+	for ( long now = 1; now <= 20000; now++ ) {
+		for ( int n = 0; n < 5; n++ ) {
+			int key = rand() % (int)expected.size();
+			if ( rand() % 4 == 0 ) {
+				wheel.cancel(key);
+				expected[key] = -1;
+			}
+			else {
+				long span = rand() % 3 ? rand() % 70 + 1 : rand() % 9000 + 1;
+				wheel.schedule(key, now + span);
+				expected[key] = now + span;
+			}
+		}
+		due.clear();
+		wheel.advance(now, due);
+		for ( unsigned int i = 0; i < due.size(); i++ ) {
+			exact = exact && expected[due[i]] == now && !wheel.pending(due[i]);
+			expected[due[i]] = -1;
+		}
+	}
+	check(exact, "timers fire exactly at their deadline");
+	bool late = false;
+	for ( unsigned int key = 0; key < expected.size(); key++ ) {
+		late = late || (expected[key] != -1 && expected[key] <= 20000);
+		late = late || (expected[key] == -1) == wheel.pending(key);
+	}
+	check(!late, "no timer missed");
+
+	// a deadline already passed fires on the next tick
+	wheel.schedule(0, 5);
+	due.clear();
+	wheel.advance(20001, due);
+	check(find(due.begin(), due.end(), 0) != due.end(), "past deadline fires next tick");
+}
+
+/**
+ * FUNCTION NAME: Test_Arena
+ *
+ * DESCRIPTION: Allocations are aligned and do not overlap, and repeating the
+ * 				same rounds of allocations after a reset needs no new chunks
+ */
+void UnitTest::Test_Arena() {
+	Arena arena;
+	size_t capacity = 0;
+	bool aligned = true, intact = true;
+
+	for ( int round = 0; round < 10; round++ ) {
+		vector<int *> arrays;
+		for ( int n = 1; n < 3000; n += 97 ) {
+			int *a = arena.allocArray<int>(n);
+			aligned = aligned && ((size_t)a % ARENA_ALIGN) == 0;
+			for ( int i = 0; i < n; i++ ) {
+				a[i] = n;
+			}
+			arrays.push_back(a);
+		}
+		// one request larger than a chunk
+		char *big = (char *) arena.alloc(3 * ARENA_CHUNK_SIZE);
+		memset(big, 1, 3 * ARENA_CHUNK_SIZE);
+		for ( unsigned int k = 0; k < arrays.size(); k++ ) {
+			int n = 1 + 97 * k;
+			intact = intact && arrays[k][0] == n && arrays[k][n - 1] == n;
+		}
+		if ( round == 0 ) {
+			capacity = arena.capacity();
+		}
+		arena.reset();
+	}
+	check(aligned, "arena allocations aligned");
+	check(intact, "arena allocations do not overlap");
+	check(arena.capacity() == capacity, "arena reuses its chunks after reset");
+
+	// requests that grow a little every round, like the member list does
+	Arena growing;
+	for ( int round = 0; round < 200; round++ ) {
+		growing.alloc(ARENA_CHUNK_SIZE + round * 100);
+		growing.alloc(ARENA_CHUNK_SIZE + round * 100);
+		growing.reset();
+	}
+	check(growing.capacity() <= 8 * (ARENA_CHUNK_SIZE + 200 * 100), "arena stays bounded by what a round uses");
+
+	Address *addrs = arena.allocArray<Address>(4);
+	MemberListEntry *entries = arena.allocArray<MemberListEntry>(4);
+	check(entries[3].id == 0 && entries[3].heartbeat == 0, "arena arrays default constructed");
+	addrs[3].init();
+}
+
+/**
+ * FUNCTION NAME: Test_Dissemination
+ *
+ * DESCRIPTION: Every message takes the events sent least often, an event goes
+ * 				out exactly limit times, and a newer event about a member
+ * 				replaces the queued one
+ */
+void UnitTest::Test_Dissemination() {
+	Dissemination buffer;
+	MemberEvent event;
+	event.type = ALIVE_EVENT;
+	event.port = 0;
+	event.incarnation = 0;
+	for ( int id = 1; id <= 10; id++ ) {
+		event.id = id;
+		buffer.add(event);
+	}
+	check(buffer.size() == 10, "one event per member");
+
+	const int limit = 4;
+	MemberEvent out[3];
+	int sent[11] = {0};
+	bool bounded = true, fair = true;
+	while ( buffer.size() > 0 ) {
+		int n = buffer.select(3, limit, out);
+		bounded = bounded && n >= 1 && n <= 3;
+		for ( int i = 0; i < n; i++ ) {
+			sent[out[i].id]++;
+		}
+		int least = limit, most = 0;
+		for ( int id = 1; id <= 10; id++ ) {
+			least = min(least, sent[id]);
+			most = max(most, sent[id]);
+		}
+		fair = fair && most - least <= 1;
+	}
+	bool exact = true;
+	for ( int id = 1; id <= 10; id++ ) {
+		exact = exact && sent[id] == limit;
+	}
+	check(bounded, "at most max events per message");
+	check(fair, "least sent events go first");
+	check(exact, "every event sent exactly limit times");
+
+	event.id = 1;
+	buffer.add(event);
+	buffer.select(1, limit, out);
+	event.type = SUSPECT_EVENT;
+	event.incarnation = 3;
+	buffer.add(event);
+	check(buffer.size() == 1, "newer event replaces the queued one");
+	int n = buffer.select(3, limit, out);
+	check(n == 1 && out[0].type == SUSPECT_EVENT && out[0].incarnation == 3, "replaced event goes out");
+}
+
+/**
+ * FUNCTION NAME: Test_ArrivalWindow
+ *
+ * DESCRIPTION: Phi grows with the silence, the deadline is where it reaches the
+ * 				threshold, and irregular arrivals push the deadline back
+ */
+void UnitTest::Test_ArrivalWindow() {
+	ArrivalWindow regular, jittery;
+	check(regular.deadline(8) == -1 && regular.phi(100) == 0, "no deadline without samples");
+
+	long t = 0;
+	for ( int i = 0; i < 2 * PHI_WINDOW; i++ ) {
+		regular.arrival(i);
+		// same tick again: not a new sample
+		regular.arrival(i);
+		t += 1 + (i % 4 == 0 ? 4 : 0);
+		jittery.arrival(t);
+	}
+	long last = 2 * PHI_WINDOW - 1;
+	check(regular.size() == PHI_WINDOW, "ring keeps PHI_WINDOW samples");
+	check(regular.phi(last + 1) < 1 && regular.phi(last + 4) < regular.phi(last + 8), "phi grows with silence");
+	long deadline = regular.deadline(8);
+	check(deadline > last + 1 && regular.phi(deadline) >= 8 && regular.phi(deadline - 1) < 8, "deadline where phi reaches threshold");
+	check(regular.deadline(12) > deadline, "higher threshold waits longer");
+	check(jittery.deadline(8) - t > deadline - last, "jitter waits longer");
+}
+
+/**
+ * FUNCTION NAME: Test_HashRing
+ *
+ * DESCRIPTION: Lookups return distinct owners, and adding or removing a member
+ * 				only moves the keys that member owns
+ */
+void UnitTest::Test_HashRing() {
+	HashRing ring, reversed;
+	Address before[3], after[3];
+	check(ring.lookupPosition(0, 3, before) == 0, "empty ring owns nothing");
+
+	for ( int id = 1; id <= 50; id++ ) {
+		ring.add(id, (short)id);
+		reversed.add(51 - id, (short)(51 - id));
+	}
+	ring.add(7, 7);
+	check(ring.size() == 50, "a member is added once");
+
+	bool distinct = true, sameOrder = true;
+	for ( int position = 0; position < RING_SIZE; position++ ) {
+		int n = ring.lookupPosition(position, 3, before);
+		distinct = distinct && n == 3 && !(before[0] == before[1]) && !(before[0] == before[2]) && !(before[1] == before[2]);
+		reversed.lookupPosition(position, 3, after);
+		sameOrder = sameOrder && before[0] == after[0] && before[1] == after[1] && before[2] == after[2];
+	}
+	check(distinct, "replicas are distinct members");
+	check(sameOrder, "owners do not depend on the join order");
+	check(ring.lookup("key", 3, before) == 3 && ring.lookup("key", 3, after) == 3 && before[0] == after[0], "same key, same owners");
+
+	// removing member 7: the owners of a position only lose 7 and gain one after the others
+	int gone = 7;
+	HashRing shrunk = ring;
+	shrunk.remove(gone);
+	check(shrunk.size() == 49 && !shrunk.contains(gone) && shrunk.contains(8), "member removed");
+	bool minimal = true;
+	int moved = 0;
+	for ( int position = 0; position < RING_SIZE; position++ ) {
+		ring.lookupPosition(position, 3, before);
+		shrunk.lookupPosition(position, 3, after);
+		int k = 0;
+		for ( int i = 0; i < 3; i++ ) {
+			if ( *(int *)(&before[i].addr) == gone ) {
+				continue;
+			}
+			minimal = minimal && before[i] == after[k];
+			k++;
+		}
+		moved += k < 3;
+	}
+	check(minimal, "only the removed member's keys move");
+	check(moved > 0 && moved < RING_SIZE / 4, "removed member owned a share of the keys");
+
+	shrunk.add(gone, (short)gone);
+	bool restored = true;
+	for ( int position = 0; position < RING_SIZE; position++ ) {
+		ring.lookupPosition(position, 3, before);
+		shrunk.lookupPosition(position, 3, after);
+		restored = restored && before[0] == after[0] && before[1] == after[1] && before[2] == after[2];
+	}
+	check(restored, "adding back restores the owners");
+
+	HashRing pair;
+	pair.add(1, 1);
+	pair.add(2, 2);
+	check(pair.lookupPosition(RING_SIZE - 1, 3, before) == 2, "at most as many replicas as members");
+}
+
+/**
+ * Change listener of the tests: env is a vector collecting the batches, each
+ * batch starting with a marker of type -1 and id the batch size
+ */
+static void collectChanges(void *env, const MemberChange *changes, int count) {
+	vector<MemberChange> *seen = (vector<MemberChange> *)env;
+	MemberChange marker = { -1, count, 0, 0 };
+	seen->push_back(marker);
+	seen->insert(seen->end(), changes, changes + count);
+}
+
+/**
+ * FUNCTION NAME: Test_MerkleTree
+ *
+ * DESCRIPTION: Updates applied one at a time give the tree a rebuild would,
+ * 				and only touch the path of the entry
+ */
+void UnitTest::Test_MerkleTree() {
+	MerkleTree off;
+	off.add(1, 1, 1);
+	check(off.getDepth() == 0, "depth 0 keeps no tree");
+
+	MerkleTree tree, rebuilt;
+	tree.init(2);
+	rebuilt.init(2);
+	check(tree.width(2) == MERKLE_FANOUT * MERKLE_FANOUT, "leaves");
+	for ( int id = 1; id <= 600; id++ ) {
+		tree.add(id, (short)id, id);
+	}
+	// member 300 leaves, 301 rejoins on another port and 302 gets a newer heartbeat
+	tree.remove(300, 300, 300);
+	tree.remove(301, 301, 301);
+	tree.add(301, 9, 301);
+	tree.beat(302, 98);
+	for ( int id = 600; id >= 1; id-- ) {
+		if ( id != 300 ) {
+			rebuilt.add(id, id == 301 ? 9 : (short)id, id == 302 ? 400 : id);
+		}
+	}
+	bool same = true;
+	for ( int level = 0; level <= 2; level++ ) {
+		for ( int i = 0; i < tree.width(level); i++ ) {
+			merkle_node &a = tree.at(level, i), &b = rebuilt.at(level, i);
+			same = same && a.hash == b.hash && a.beats == b.beats && a.count == b.count;
+		}
+	}
+	check(same, "incremental updates match a rebuild");
+	check(tree.at(0, 0).count == 599, "root counts every entry");
+
+	MerkleTree before = rebuilt;
+	rebuilt.beat(77, 5);
+	int changed = 0;
+	for ( int level = 0; level <= 2; level++ ) {
+		for ( int i = 0; i < rebuilt.width(level); i++ ) {
+			changed += rebuilt.at(level, i).beats != before.at(level, i).beats;
+		}
+	}
+	check(changed == 3, "a heartbeat updates one node per level");
+	check(rebuilt.at(2, rebuilt.leafOf(77)).beats == before.at(2, rebuilt.leafOf(77)).beats + 5, "on the path of the entry");
+	check(rebuilt.nodeOf(77, 1) == rebuilt.leafOf(77) / MERKLE_FANOUT && rebuilt.nodeOf(77, 0) == 0, "parents group neighbouring leaves");
+}
+
+/**
+ * FUNCTION NAME: Test_ChangeFeed
+ *
+ * DESCRIPTION: Changes reach every listener in order, batched per flush, and a
+ * 				full ring is delivered early instead of dropping changes
+ */
+void UnitTest::Test_ChangeFeed() {
+	ChangeFeed feed;
+	vector<MemberChange> first, second;
+	feed.record(JOIN_CHANGE, 1, 0, 1);
+	check(feed.pending() == 0, "nothing buffered without listeners");
+
+	int handle = feed.subscribe(collectChanges, &first);
+	feed.subscribe(collectChanges, &second);
+	feed.flush();
+	check(first.empty(), "no batch without changes");
+	feed.record(JOIN_CHANGE, 2, 5, 3);
+	feed.record(SUSPECT_CHANGE, 3, 6, 3);
+	feed.record(FAIL_CHANGE, 3, 6, 3);
+	check(feed.pending() == 3 && first.empty(), "changes wait for the flush");
+	feed.flush();
+	check(first.size() == 4 && first[0].type == -1 && first[0].id == 3, "one batch per flush");
+	check(first[1].type == JOIN_CHANGE && first[1].id == 2 && first[1].port == 5 && first[1].tick == 3
+			&& first[2].type == SUSPECT_CHANGE && first[3].type == FAIL_CHANGE, "changes in order");
+	check(second.size() == first.size(), "every listener gets the batch");
+
+	// fill the ring past its end: the first CHANGE_RING go out early, the rest wrap around
+	feed.unsubscribe(handle);
+	second.clear();
+	for ( int i = 0; i < CHANGE_RING + 10; i++ ) {
+		feed.record(LEAVE_CHANGE, 100 + i, 0, 4);
+	}
+	check(feed.pending() == 10, "full ring delivered early");
+	feed.flush();
+	int delivered = 0;
+	bool ordered = true;
+	for ( unsigned int i = 0; i < second.size(); i++ ) {
+		if ( second[i].type != -1 ) {
+			ordered = ordered && second[i].id == 100 + delivered;
+			delivered++;
+		}
+	}
+	check(delivered == CHANGE_RING + 10 && ordered, "no change lost or reordered");
+	check(first.size() == 4, "unsubscribed listener gets nothing");
+}
+
+/**
+ * FUNCTION NAME: Test_BatchMerge
+ *
+ * DESCRIPTION: Two nodes, one merging every message on its own and one with
+ * 				BATCH_MERGE, receive the same queued gossip over a few ticks and
+ * 				end with the same member table
+ */
+void UnitTest::Test_BatchMerge() {
+	Params par[2];
+	Log *log[2];
+	EmulNet *net[2];
+	MP1Node *node[2];
+	for ( int k = 0; k < 2; k++ ) {
+		par[k].setparams((char *)"testcases/multifailure.conf");
+		par[k].setparam((char *)"BATCH_MERGE", k);
+		log[k] = new Log(&par[k]);
+		net[k] = new EmulNet(&par[k]);
+		Address addr;
+		net[k]->ENinit(&addr, par[k].PORTNUM);
+		node[k] = new MP1Node(new Member, &par[k], net[k], log[k], &addr);
+		node[k]->initThisNode(&addr);
+	}
+
+	srand(3);
+	bool same = true;
+	for ( int tick = 1; tick <= 5; tick++ ) {
+		// per message: sender, type, and entries, the same for both nodes
+		for ( int m = 0; m < 20; m++ ) {
+			int from = rand() % 60 + 2;
+			int kind = rand() % 10;
+			vector<MemberListEntry> entries;
+			for ( int i = rand() % 15; i > 0; i-- ) {
+				int id = rand() % 60 + 2;
+				entries.push_back(MemberListEntry(id, (short)par[0].PORTNUM, tick * 10 + rand() % 20, 0));
+			}
+			Address subject(to_string(rand() % 60 + 2) + ":" + to_string(par[0].PORTNUM));
+			for ( int k = 0; k < 2; k++ ) {
+				par[k].globaltime = tick;
+				Address sender(to_string(from) + ":" + to_string(par[k].PORTNUM));
+				Message message(net[k]);
+				if ( kind == 0 ) {
+					message.setFailed(sender, tick, subject);
+				}
+				else if ( kind < 3 ) {
+					message.setDelta(sender, tick, 0, tick, entries);
+				}
+				else {
+					message.setJoinep(sender, tick, entries);
+				}
+				node[k]->getMemberNode()->mp1q.push(q_elt(message.getBuf(), (int)message.getSize()));
+			}
+		}
+		// the nodes trace every message they receive; keep that out of the report
+		ostringstream trace;
+		streambuf *out = cout.rdbuf(trace.rdbuf());
+		for ( int k = 0; k < 2; k++ ) {
+			node[k]->checkMessages();
+		}
+		cout.rdbuf(out);
+		vector<MemberListEntry> a = node[0]->getMemberNode()->memberList;
+		vector<MemberListEntry> b = node[1]->getMemberNode()->memberList;
+		sort(a.begin(), a.end(), compareEntryId);
+		sort(b.begin(), b.end(), compareEntryId);
+		same = same && a.size() == b.size() && a.size() > 1;
+		for ( unsigned int i = 0; same && i < a.size(); i++ ) {
+			same = a[i].id == b[i].id && a[i].port == b[i].port
+					&& a[i].heartbeat == b[i].heartbeat && a[i].timestamp == b[i].timestamp;
+		}
+	}
+	check(same, "batched merge ends with the same table as merging per message");
+
+	for ( int k = 0; k < 2; k++ ) {
+		delete node[k]->getMemberNode();
+		delete node[k];
+		delete net[k];
+		delete log[k];
+	}
+}
+
+/**
+ * Pool task of the tests: env is an array recording which worker did each item
+ */
+static void markItems(void *env, int begin, int end) {
+	int *owner = (int *)env;
+	for ( int i = begin; i < end; i++ ) {
+		owner[i] = ThreadPool::self();
+	}
+}
+
+/**
+ * FUNCTION NAME: Test_ThreadPool
+ *
+ * DESCRIPTION: Every item of a run is done once, the workers get contiguous
+ * 				blocks in order, and a run returns only once all are done
+ */
+void UnitTest::Test_ThreadPool() {
+	ThreadPool pool;
+	check(pool.size() == 0 && ThreadPool::self() == -1, "no workers before start");
+	pool.start(3);
+	check(pool.size() == 3, "workers started");
+
+	vector<int> owner(100);
+	bool done = true, ordered = true;
+	for ( int round = 0; round < 50; round++ ) {
+		fill(owner.begin(), owner.end(), -1);
+		pool.run(markItems, &owner[0], (int)owner.size());
+		for ( unsigned int i = 0; i < owner.size(); i++ ) {
+			done = done && owner[i] >= 0;
+			ordered = ordered && (i == 0 || owner[i] >= owner[i-1]);
+		}
+	}
+	check(done, "run returns once every item is done");
+	check(ordered && owner[0] == 0 && owner[99] == 2, "contiguous blocks in worker order");
+	check(count(owner.begin(), owner.end(), 1) == 33, "blocks balanced");
+
+	fill(owner.begin(), owner.end(), -1);
+	pool.run(markItems, &owner[0], 2);
+	check(owner[0] >= 0 && owner[1] >= 0 && owner[2] == -1, "fewer items than workers");
+}
+
+/**
+ * Start the n nodes of a protocol test on net, ids 1 to n, each in the group
+ * and knowing only itself
+ */
+static void startNodes(Params *par, EmulNet *net, Log *log, MP1Node **node, int n) {
+	for ( int k = 0; k < n; k++ ) {
+		Address addr;
+		net->ENinit(&addr, par->PORTNUM);
+		node[k] = new MP1Node(new Member, par, net, log, &addr);
+		node[k]->initThisNode(&addr);
+		node[k]->getMemberNode()->inGroup = true;
+	}
+}
+
+/**
+ * Tear down the nodes of startNodes
+ */
+static void stopNodes(MP1Node **node, int n) {
+	for ( int k = 0; k < n; k++ ) {
+		delete node[k]->getMemberNode();
+		delete node[k];
+	}
+}
+
+/**
+ * Take the messages waiting for node out of the network, to look at them
+ * before handing them over with handMessages
+ */
+static vector<q_elt> takeMessages(EmulNet *net, MP1Node *node) {
+	vector<q_elt> got;
+	net->ENrecv(&node->getMemberNode()->addr, collectMsg, NULL, 1, &got);
+	return got;
+}
+
+/**
+ * Queue msgs at node, which handles them and frees them in its next nodeLoop
+ */
+static void handMessages(MP1Node *node, vector<q_elt> &msgs) {
+	for ( unsigned int i = 0; i < msgs.size(); i++ ) {
+		node->getMemberNode()->mp1q.push(msgs[i]);
+	}
+}
+
+/**
+ * Queue at node a JOINREP from sender listing the given members, as if sender
+ * had gossiped them
+ */
+static void handList(EmulNet *net, MP1Node *node, Address sender, vector<MemberListEntry> entries) {
+	Message message(net);
+	message.setJoinep(sender, 1, entries);
+	node->getMemberNode()->mp1q.push(q_elt(message.getBuf(), (int)message.getSize()));
+}
+
+/**
+ * FUNCTION NAME: Test_Delta
+ *
+ * DESCRIPTION: A delta covers the versions since the last one sent to the peer
+ * 				and only the entries changed in between; a delta whose base is
+ * 				past what we received makes us ask for a full sync, and the
+ * 				peer's next delta is the full list
+ */
+void UnitTest::Test_Delta() {
+	Params par;
+	par.setparams((char *)"testcases/multifailure.conf");
+	par.setparam((char *)"DELTA_GOSSIP", 1);
+	par.setparam((char *)"FULL_SYNC_PERIOD", 0);
+	par.setparam((char *)"GOSSIP_FANOUT", 0);
+	par.globaltime = 1;
+	Log log(&par);
+	EmulNet net(&par);
+	MP1Node *node[2];
+	startNodes(&par, &net, &log, node, 2);
+	Address a = node[0]->getMemberNode()->addr;
+	Address b = node[1]->getMemberNode()->addr;
+	handList(&net, node[0], b, vector<MemberListEntry>(1, MemberListEntry(2, 0, 1, 1)));
+	handList(&net, node[1], a, vector<MemberListEntry>(1, MemberListEntry(1, 0, 1, 1)));
+
+	ostringstream trace;
+	streambuf *out = cout.rdbuf(trace.rdbuf());
+	// first delta: the full list, from version 0
+	par.globaltime = 2;
+	node[0]->nodeLoop();
+	vector<q_elt> got = takeMessages(&net, node[1]);
+	long upto = -1;
+	bool full = got.size() == 1;
+	if ( full ) {
+		MessageView view((char *)got[0].elt, got[0].size);
+		full = view.getMessageType() == DELTAREP && view.getBase() == 0 && view.getUpto() > 0 && view.getEntryCount() == 2;
+		upto = view.getUpto();
+	}
+	check(full, "first delta is the full list from version 0");
+	handMessages(node[1], got);
+	node[1]->nodeLoop();
+	takeMessages(&net, node[0]).swap(got);
+	handMessages(node[0], got);
+
+	// next delta: from where the last one ended, with only my own, newer heartbeat
+	par.globaltime = 3;
+	node[0]->nodeLoop();
+	takeMessages(&net, node[1]).swap(got);
+	bool delta = got.size() == 1;
+	if ( delta ) {
+		MessageView view((char *)got[0].elt, got[0].size);
+		EntryCursor entries = view.getEntries();
+		MemberListEntry entry;
+		delta = view.getMessageType() == DELTAREP && view.getBase() == upto && view.getUpto() > upto
+				&& view.getEntryCount() == 1 && entries.next(entry) && entry.id == 1;
+		upto = view.getUpto();
+	}
+	check(delta, "next delta starts at the last version sent and carries only the changes");
+	handMessages(node[1], got);
+
+	// a delta from a base we never received: ask for a full sync
+	Message gap(&net);
+	gap.setDelta(a, 10, upto + 5, upto + 6, vector<MemberListEntry>());
+	node[1]->getMemberNode()->mp1q.push(q_elt(gap.getBuf(), (int)gap.getSize()));
+	node[1]->nodeLoop();
+	takeMessages(&net, node[0]).swap(got);
+	bool asked = false;
+	for ( unsigned int i = 0; i < got.size(); i++ ) {
+		MessageView view((char *)got[i].elt, got[i].size);
+		asked = asked || (view.getMessageType() == SYNCREQ && view.getId() == 2);
+	}
+	check(asked, "missing base version answered with SYNCREQ");
+	handMessages(node[0], got);
+
+	par.globaltime = 4;
+	node[0]->nodeLoop();
+	takeMessages(&net, node[1]).swap(got);
+	bool synced = got.size() == 1;
+	if ( synced ) {
+		MessageView view((char *)got[0].elt, got[0].size);
+		synced = view.getMessageType() == DELTAREP && view.getBase() == 0 && view.getEntryCount() == 2;
+	}
+	check(synced, "delta after SYNCREQ is the full list");
+	handMessages(node[1], got);
+	node[1]->nodeLoop();
+	cout.rdbuf(out);
+
+	stopNodes(node, 2);
+}
+
+/**
+ * FUNCTION NAME: Test_Fragments
+ *
+ * DESCRIPTION: A member list too large for one message goes out in fragments
+ * 				that each fit in MAX_MSG_SIZE and together hold the whole list,
+ * 				which the receiver ends up with
+ */
+void UnitTest::Test_Fragments() {
+	Params par;
+	par.setparams((char *)"testcases/multifailure.conf");
+	par.setparam((char *)"MAX_MSG_SIZE", 200);
+	par.setparam((char *)"GOSSIP_FANOUT", 0);
+	par.globaltime = 1;
+	Log log(&par);
+	EmulNet net(&par);
+	MP1Node *node[2];
+	startNodes(&par, &net, &log, node, 2);
+	vector<MemberListEntry> members;
+	for ( int id = 2; id < 300; id++ ) {
+		members.push_back(MemberListEntry(id, 0, 1 + (id * 7919) % 5000, 1));
+	}
+	handList(&net, node[0], node[1]->getMemberNode()->addr, members);
+
+	ostringstream trace;
+	streambuf *out = cout.rdbuf(trace.rdbuf());
+	par.globaltime = 2;
+	node[0]->nodeLoop();
+	vector<q_elt> got = takeMessages(&net, node[1]);
+	bool fit = got.size() > 1;
+	vector<int> seen(got.size(), 0);
+	vector<MemberListEntry> decoded;
+	for ( unsigned int i = 0; fit && i < got.size(); i++ ) {
+		MessageView view((char *)got[i].elt, got[i].size);
+		fit = view.getMessageType() == JOINREP && got[i].size <= par.MAX_MSG_SIZE
+				&& view.getFragments() == (int)got.size() && !seen[view.getFragment()]++;
+		EntryCursor entries = view.getEntries();
+		MemberListEntry entry;
+		while ( entries.next(entry) ) {
+			decoded.push_back(entry);
+		}
+	}
+	check(fit, "every fragment fits in MAX_MSG_SIZE and is sent once");
+
+	vector<MemberListEntry> sent = node[0]->getMemberNode()->memberList;
+	sort(sent.begin(), sent.end(), compareEntryId);
+	sort(decoded.begin(), decoded.end(), compareEntryId);
+	bool whole = decoded.size() == sent.size() && sent.size() == 299;
+	for ( unsigned int i = 0; whole && i < sent.size(); i++ ) {
+		whole = decoded[i].id == sent[i].id && decoded[i].port == sent[i].port && decoded[i].heartbeat == sent[i].heartbeat;
+	}
+	check(whole, "fragments put together hold the whole list");
+
+	handMessages(node[1], got);
+	node[1]->nodeLoop();
+	cout.rdbuf(out);
+	vector<MemberListEntry> received = node[1]->getMemberNode()->memberList;
+	sort(received.begin(), received.end(), compareEntryId);
+	bool same = received.size() == sent.size();
+	for ( unsigned int i = 0; same && i < sent.size(); i++ ) {
+		same = received[i].id == sent[i].id && received[i].port == sent[i].port
+				&& (received[i].heartbeat == sent[i].heartbeat || received[i].id == 2);
+	}
+	check(same, "receiver ends with the sender's list");
+
+	stopNodes(node, 2);
+}
+
+/**
+ * FUNCTION NAME: Test_Swim
+ *
+ * DESCRIPTION: A member that never answers is pinged, then probed through
+ * 				another member with PINGREQ, suspected at the end of the period
+ * 				and confirmed failed TFAIL ticks later; a member that answers is
+ * 				never suspected
+ */
+void UnitTest::Test_Swim() {
+	Params par;
+	par.setparams((char *)"testcases/multifailure.conf");
+	par.setparam((char *)"SWIM_DETECTOR", 1);
+	par.setparam((char *)"SWIM_PERIOD", 3);
+	par.setparam((char *)"SWIM_K", 1);
+	// no list gossip, so that only the probes spread what happens
+	par.setparam((char *)"GOSSIP_PERIOD", 1000);
+	par.globaltime = 1;
+	Log log(&par);
+	EmulNet net(&par);
+	// node 3 stands for a crashed member: its messages are thrown away unread
+	MP1Node *node[3];
+	startNodes(&par, &net, &log, node, 3);
+	vector<MemberListEntry> others;
+	others.push_back(MemberListEntry(2, 0, 1, 1));
+	others.push_back(MemberListEntry(3, 0, 1, 1));
+	handList(&net, node[0], node[1]->getMemberNode()->addr, others);
+	handList(&net, node[1], node[0]->getMemberNode()->addr, vector<MemberListEntry>(1, MemberListEntry(1, 0, 1, 1)));
+	vector<MemberChange> seen;
+	node[0]->subscribe(collectChanges, &seen);
+
+	ostringstream trace;
+	streambuf *out = cout.rdbuf(trace.rdbuf());
+	long pingReq = -1;
+	bool announced = false;
+	for ( int tick = 2; tick <= 30; tick++ ) {
+		par.globaltime = tick;
+		vector<q_elt> got = takeMessages(&net, node[2]);
+		for ( unsigned int i = 0; i < got.size(); i++ ) {
+			net.ENfree((char *)got[i].elt);
+		}
+		takeMessages(&net, node[0]).swap(got);
+		handMessages(node[0], got);
+		node[0]->nodeLoop();
+		takeMessages(&net, node[1]).swap(got);
+		for ( unsigned int i = 0; i < got.size(); i++ ) {
+			MessageView view((char *)got[i].elt, got[i].size);
+			if ( view.getMessageType() == PINGREQ && view.getId() == 1 && view.getSubjectId() == 3 && pingReq < 0 ) {
+				pingReq = tick;
+			}
+			announced = announced || (view.getMessageType() == FAILED && view.getSubjectId() == 3);
+		}
+		handMessages(node[1], got);
+		node[1]->nodeLoop();
+	}
+	cout.rdbuf(out);
+
+	long suspected = -1, failed = -1;
+	bool answererKept = true;
+	for ( unsigned int i = 0; i < seen.size(); i++ ) {
+		if ( seen[i].type == SUSPECT_CHANGE && seen[i].id == 3 && suspected < 0 ) {
+			suspected = seen[i].tick;
+		}
+		if ( seen[i].type == FAIL_CHANGE && seen[i].id == 3 && failed < 0 ) {
+			failed = seen[i].tick;
+		}
+		answererKept = answererKept && !(seen[i].id == 2 && (seen[i].type == SUSPECT_CHANGE || seen[i].type == FAIL_CHANGE));
+	}
+	check(pingReq > 0, "silent member probed indirectly with PINGREQ");
+	check(suspected > pingReq, "silent member suspected after the indirect probe");
+	check(failed == suspected + TFAIL, "suspect confirmed failed after TFAIL ticks");
+	check(announced, "failure announced to the other members");
+	check(answererKept, "member that answers is never suspected");
+
+	stopNodes(node, 3);
+}
+
+/**
+ * FUNCTION NAME: Test_Digest
+ *
+ * DESCRIPTION: A digest is answered with the entries of the ranges where the
+ * 				receiver knows a member the sender does not, or where its
+ * 				heartbeats are ahead, and with nothing from the other ranges
+ */
+void UnitTest::Test_Digest() {
+	Params par;
+	par.setparams((char *)"testcases/multifailure.conf");
+	par.setparam((char *)"DIGEST_GOSSIP", 1);
+	par.setparam((char *)"DIGEST_RANGES", 8);
+	par.setparam((char *)"GOSSIP_FANOUT", 0);
+	par.globaltime = 1;
+	Log log(&par);
+	EmulNet net(&par);
+	MP1Node *node[2];
+	startNodes(&par, &net, &log, node, 2);
+	// node 2 also knows member 13, in range 5, and has a newer heartbeat of
+	// member 20 in range 4; the other ranges are the same on both sides
+	vector<MemberListEntry> known, ahead;
+	for ( int id = 1; id <= 40; id++ ) {
+		if ( id != 1 && id != 13 ) {
+			known.push_back(MemberListEntry(id, 0, 1, 1));
+		}
+		if ( id != 2 ) {
+			ahead.push_back(MemberListEntry(id, 0, id == 20 ? 100 : 1, 1));
+		}
+	}
+	handList(&net, node[0], node[1]->getMemberNode()->addr, known);
+	handList(&net, node[1], node[0]->getMemberNode()->addr, ahead);
+
+	ostringstream trace;
+	streambuf *out = cout.rdbuf(trace.rdbuf());
+	par.globaltime = 2;
+	node[0]->nodeLoop();
+	vector<q_elt> got = takeMessages(&net, node[1]);
+	handMessages(node[1], got);
+	node[1]->nodeLoop();
+	takeMessages(&net, node[0]).swap(got);
+	cout.rdbuf(out);
+
+	vector<int> expected, returned;
+	for ( int id = 3; id <= 40; id++ ) {
+		if ( id % 8 == 4 || id % 8 == 5 ) {
+			expected.push_back(id);
+		}
+	}
+	int replies = 0;
+	for ( unsigned int i = 0; i < got.size(); i++ ) {
+		MessageView view((char *)got[i].elt, got[i].size);
+		if ( view.getMessageType() == JOINREP ) {
+			replies++;
+			EntryCursor entries = view.getEntries();
+			MemberListEntry entry;
+			while ( entries.next(entry) ) {
+				returned.push_back(entry.id);
+			}
+		}
+		net.ENfree((char *)got[i].elt);
+	}
+	sort(returned.begin(), returned.end());
+	check(replies == 1, "digest answered once");
+	check(returned == expected, "only the entries of the differing ranges come back");
+
+	stopNodes(node, 2);
+}
+
+/**
+ * FUNCTION NAME: Test_JoinBatch
+ *
+ * DESCRIPTION: The joiners of one tick all get the same JOINREP, serialized
+ * 				once and listing every one of them, and are in the group once
+ * 				they have handled it
+ */
+void UnitTest::Test_JoinBatch() {
+	Params par;
+	par.setparams((char *)"testcases/multifailure.conf");
+	// no list gossip, so that the JOINREP are the introducer's answers
+	par.setparam((char *)"GOSSIP_PERIOD", 1000);
+	par.globaltime = 1;
+	Log log(&par);
+	EmulNet net(&par);
+	const int joining = 9;
+	MP1Node *node[joining + 1];
+	startNodes(&par, &net, &log, node, joining + 1);
+	Address introducer = node[0]->getMemberNode()->addr;
+	for ( int k = 1; k <= joining; k++ ) {
+		node[k]->getMemberNode()->inGroup = false;
+		node[k]->sendJoinRequest(&introducer);
+	}
+
+	ostringstream trace;
+	streambuf *out = cout.rdbuf(trace.rdbuf());
+	par.globaltime = 2;
+	vector<q_elt> got = takeMessages(&net, node[0]);
+	check(got.size() == joining, "every JOINREQ reaches the introducer");
+	handMessages(node[0], got);
+	node[0]->nodeLoop();
+
+	void *shared = NULL;
+	bool once = true, complete = true;
+	for ( int k = 1; k <= joining; k++ ) {
+		takeMessages(&net, node[k]).swap(got);
+		once = once && got.size() == 1 && (shared == NULL || got[0].elt == shared);
+		if ( got.size() == 1 ) {
+			shared = got[0].elt;
+			MessageView view((char *)got[0].elt, got[0].size);
+			EntryCursor entries = view.getEntries();
+			MemberListEntry entry;
+			vector<int> ids;
+			while ( entries.next(entry) ) {
+				ids.push_back(entry.id);
+			}
+			sort(ids.begin(), ids.end());
+			complete = complete && view.getMessageType() == JOINREP && (int)ids.size() == joining + 1
+					&& ids.front() == 1 && ids.back() == joining + 1;
+		}
+		handMessages(node[k], got);
+		node[k]->nodeLoop();
+		complete = complete && node[k]->getMemberNode()->inGroup;
+	}
+	cout.rdbuf(out);
+	check(once, "one shared JOINREP for all the joiners of a tick");
+	check(complete, "the JOINREP lists every joiner and lets it in");
+
+	stopNodes(node, joining + 1);
+}
+
+/**
+ * Node id of an address
+ */
+static int idOf(Address addr) {
+	return *(int *)(&addr.addr);
+}
+
+/**
+ * FUNCTION NAME: Test_Introducers
+ *
+ * DESCRIPTION: A joiner always asks the same introducer first, the joiners
+ * 				are spread over all the introducers, and a retry asks the next one
+ */
+void UnitTest::Test_Introducers() {
+	Params par;
+	par.setparams((char *)"testcases/multifailure.conf");
+	par.setparam((char *)"INTRODUCERS", 4);
+	par.globaltime = 1;
+	Log log(&par);
+	EmulNet net(&par);
+	const int nodes = 200;
+	MP1Node *node[nodes];
+	startNodes(&par, &net, &log, node, nodes);
+
+	bool stable = true, introducersFirst = true;
+	vector<int> asked(par.INTRODUCERS + 1, 0);
+	int joiners = 0;
+	for ( int k = 0; k < nodes; k++ ) {
+		Address addr = node[k]->getMemberNode()->addr;
+		int first = idOf(node[k]->getJoinAddress());
+		// another node with the same id, as after a restart
+		Member member;
+		MP1Node again(&member, &par, &net, &log, &addr);
+		stable = stable && idOf(again.getJoinAddress()) == first && idOf(node[k]->getJoinAddress()) == first;
+		if ( k < par.INTRODUCERS ) {
+			introducersFirst = introducersFirst && first == 1;
+		}
+		else if ( first >= 1 && first <= par.INTRODUCERS ) {
+			asked[first]++;
+			joiners++;
+		}
+	}
+	check(stable, "a joiner always asks the same introducer first");
+	check(introducersFirst, "introducers join through introducer 1");
+	bool covered = true;
+	for ( int i = 1; i <= par.INTRODUCERS; i++ ) {
+		covered = covered && asked[i] >= (nodes - par.INTRODUCERS) / par.INTRODUCERS / 2;
+	}
+	check(covered && joiners == nodes - par.INTRODUCERS, "joiners spread over every introducer");
+
+	// without an answer, every introducer is tried in turn
+	MP1Node *joiner = node[nodes - 1];
+	int first = idOf(joiner->getJoinAddress());
+	joiner->sendJoinRequest(&node[first - 1]->getMemberNode()->addr);
+	joiner->retryJoin();
+	check(idOf(joiner->getJoinAddress()) == first, "no retry before JOIN_TIMEOUT");
+	vector<int> tried(1, first);
+	for ( int attempt = 1; attempt < par.INTRODUCERS; attempt++ ) {
+		par.globaltime += JOIN_TIMEOUT;
+		joiner->retryJoin();
+		tried.push_back(idOf(joiner->getJoinAddress()));
+	}
+	check(tried[1] != first, "retry moves on from the first introducer");
+	sort(tried.begin(), tried.end());
+	check(tried.front() == 1 && tried.back() == par.INTRODUCERS
+			&& unique(tried.begin(), tried.end()) == tried.end(), "retries ask every other introducer");
+
+	stopNodes(node, nodes);
+}
+
+/**
+ * FUNCTION NAME: Test_Regions
+ *
+ * DESCRIPTION: With REGIONS, a member keeps its whole region and the REGION_REPS
+ * 				lowest ids of every other region, evicting higher ones it kept
+ * 				before; only the representatives of a region send its summary,
+ * 				which holds the representatives alone
+ */
+void UnitTest::Test_Regions() {
+	Params par;
+	par.setparams((char *)"testcases/multifailure.conf");
+	par.setparam((char *)"REGIONS", 4);
+	par.setparam((char *)"GOSSIP_FANOUT", 0);
+	par.globaltime = 1;
+	Log log(&par);
+	EmulNet net(&par);
+	// ids 1, 5 and 9 are in region 0, ids 1 and 5 represent it
+	MP1Node *node[9];
+	startNodes(&par, &net, &log, node, 9);
+	vector<MemberListEntry> high, low;
+	for ( int id = 1; id <= 40; id++ ) {
+		(id > 20 ? high : low).push_back(MemberListEntry(id, 0, 1, 1));
+	}
+	vector<MemberChange> seen;
+	node[0]->subscribe(collectChanges, &seen);
+	for ( int k = 0; k < 9; k += 8 ) {
+		handList(&net, node[k], node[1]->getMemberNode()->addr, high);
+		handList(&net, node[k], node[1]->getMemberNode()->addr, low);
+	}
+
+	ostringstream trace;
+	streambuf *out = cout.rdbuf(trace.rdbuf());
+	par.globaltime = 2;
+	node[0]->nodeLoop();
+	node[8]->nodeLoop();
+	cout.rdbuf(out);
+
+	vector<int> kept, expected;
+	for ( unsigned int i = 0; i < node[0]->getMemberNode()->memberList.size(); i++ ) {
+		kept.push_back(node[0]->getMemberNode()->memberList[i].id);
+	}
+	for ( int id = 1; id <= 40; id++ ) {
+		if ( (id - 1) % 4 == 0 || id <= 8 ) {
+			expected.push_back(id);
+		}
+	}
+	sort(kept.begin(), kept.end());
+	check(kept == expected, "whole region and the lowest ids of the other regions kept");
+	vector<int> evicted;
+	for ( unsigned int i = 0; i < seen.size(); i++ ) {
+		if ( seen[i].type == EVICT_CHANGE ) {
+			evicted.push_back(seen[i].id);
+		}
+	}
+	sort(evicted.begin(), evicted.end());
+	int lowestHigh[] = { 22, 23, 24, 26, 27, 28 };
+	check(evicted == vector<int>(lowestHigh, lowestHigh + 6), "representatives kept before evicted by lower ids");
+
+	// node 9 knows ids 1 and 5 and so does not represent region 0; a summary is
+	// the only list from region 0 without member 9
+	int summaries = 0;
+	bool onlyReps = true;
+	for ( int k = 1; k < 8; k++ ) {
+		vector<q_elt> got = takeMessages(&net, node[k]);
+		for ( unsigned int i = 0; i < got.size(); i++ ) {
+			MessageView view((char *)got[i].elt, got[i].size);
+			vector<int> ids;
+			EntryCursor entries = view.getEntries();
+			MemberListEntry entry;
+			while ( entries.next(entry) ) {
+				ids.push_back(entry.id);
+			}
+			sort(ids.begin(), ids.end());
+			if ( view.getMessageType() == JOINREP && !binary_search(ids.begin(), ids.end(), 9) ) {
+				summaries++;
+				onlyReps = onlyReps && view.getId() == 1 && k % 4 != 0 && ids == vector<int>(expected.begin(), expected.begin() + 8);
+			}
+			net.ENfree((char *)got[i].elt);
+		}
+	}
+	check(summaries == 1 && onlyReps, "one summary, from a representative to another region, listing the representatives");
+
+	stopNodes(node, 9);
+}
+
+/**
+ * FUNCTION NAME: bench
+ *
+ * DESCRIPTION: Run every microbenchmark
+ */
+void UnitTest::bench() {
+	Bench_HashRing(100);
+	Bench_HashRing(1000);
+}
+
+/**
+ * FUNCTION NAME: Bench_HashRing
+ *
+ * DESCRIPTION: Lookups per second on a ring of members, and the cost of one
+ * 				member leaving and joining against rebuilding the whole ring
+ */
+void UnitTest::Bench_HashRing(int members) {
+	HashRing ring;
+	for ( int id = 1; id <= members; id++ ) {
+		ring.add(id, 0);
+	}
+	char key[32];
+	Address owners[3];
+	int lookups = 1000000;
+	long sink = 0;
+	clock_t start = clock();
+	for ( int i = 0; i < lookups; i++ ) {
+		sprintf(key, "key%d", i);
+		ring.lookup(key, 3, owners);
+		sink += owners[0].addr[0];
+	}
+	double lookupSecs = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+	int churns = 10000;
+	start = clock();
+	for ( int i = 0; i < churns; i++ ) {
+		int id = i % members + 1;
+		ring.remove(id);
+		ring.add(id, 0);
+	}
+	double churnSecs = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+	int rebuilds = max(1, 100000 / members);
+	start = clock();
+	for ( int i = 0; i < rebuilds; i++ ) {
+		HashRing fresh;
+		for ( int id = 1; id <= members; id++ ) {
+			fresh.add(id, 0);
+		}
+		sink += fresh.size();
+	}
+	double rebuildSecs = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+	printf("HashRing %d members: %.0f lookups/s, leave+join %.2f us, full rebuild %.2f us (%ld)\n",
+			members, lookups / lookupSecs, churnSecs * 1e6 / churns, rebuildSecs * 1e6 / rebuilds, sink % 2);
+}
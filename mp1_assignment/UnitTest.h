@@ -0,0 +1,57 @@
+/**********************************
+ * FILE NAME: UnitTest.h
+ *
+ * DESCRIPTION: Header file of UnitTest class
+ **********************************/
+
+#ifndef _UNITTEST_H_
+#define _UNITTEST_H_
+
+#include "stdincludes.h"
+#include "Member.h"
+#include "MP1Node.h"
+#include "ThreadPool.h"
+
+/**
+ * CLASS NAME: UnitTest
+ *
+ * DESCRIPTION: Self checks of the protocol building blocks, run with
+ * 				./Application --unittest, and their microbenchmarks, run with
+ * 				./Application --bench
+ */
+class UnitTest {
+private:
+	int failures;
+	void check(bool cond, const char *what);
+public:
+	UnitTest();
+	virtual ~UnitTest() {}
+	int run();
+	void Test_Mailbox();
+	void Test_MsgCounter();
+	void Test_BufferPool();
+	void Test_Multicast();
+	void Test_Message();
+	void Test_MessageSize();
+	void Test_MemberTable();
+	void Test_TimerWheel();
+	void Test_Arena();
+	void Test_Dissemination();
+	void Test_ArrivalWindow();
+	void Test_HashRing();
+	void Test_ChangeFeed();
+	void Test_MerkleTree();
+	void Test_BatchMerge();
+	void Test_ThreadPool();
+	void Test_Delta();
+	void Test_Fragments();
+	void Test_Swim();
+	void Test_Digest();
+	void Test_JoinBatch();
+	void Test_Introducers();
+	void Test_Regions();
+	void bench();
+	void Bench_HashRing(int members);
+};
+
+#endif /* _UNITTEST_H_ */
@@ -0,0 +1,152 @@
+/**********************************
+ * FILE NAME: WireFormat.cpp
+ *
+ * DESCRIPTION: Definition of the byte level encoding used by protocol messages.
+ * 				Varints are LEB128: 7 bits per byte, least significant group
+ * 				first, high bit set on all but the last byte. Signed values
+ * 				are zigzag mapped first so that small magnitudes stay short.
+ **********************************/
+
+#include "WireFormat.h"
+
+/**
+ * Constructor
+ */
+WireWriter::WireWriter(char *buf): buf(buf), pos(0) {}
+
+/**
+ * FUNCTION NAME: putByte
+ *
+ * DESCRIPTION: Append one byte
+ */
+void WireWriter::putByte(unsigned char b) {
+	if ( buf != NULL ) {
+		buf[pos] = (char)b;
+	}
+	pos++;
+}
+
+/**
+ * FUNCTION NAME: putFixed32
+ *
+ * DESCRIPTION: Append a 32-bit integer, little-endian, for values such as hashes
+ * 				that a varint would only make longer
+ */
+void WireWriter::putFixed32(unsigned int v) {
+	for ( int i = 0; i < 4; i++ ) {
+		putByte((unsigned char)(v >> (8 * i)));
+	}
+}
+
+/**
+ * FUNCTION NAME: putVarint
+ *
+ * DESCRIPTION: Append an unsigned varint
+ */
+void WireWriter::putVarint(unsigned long v) {
+	while ( v >= 0x80 ) {
+		putByte((unsigned char)(v | 0x80));
+		v >>= 7;
+	}
+	putByte((unsigned char)v);
+}
+
+/**
+ * FUNCTION NAME: putSVarint
+ *
+ * DESCRIPTION: Append a signed varint, zigzag encoded
+ */
+void WireWriter::putSVarint(long v) {
+	putVarint(((unsigned long)v << 1) ^ (unsigned long)(v >> (sizeof(long) * 8 - 1)));
+}
+
+/**
+ * FUNCTION NAME: getSize
+ *
+ * DESCRIPTION: Number of bytes written so far
+ */
+size_t WireWriter::getSize() {
+	return pos;
+}
+
+/**
+ * Constructor
+ */
+WireReader::WireReader(const char *buf, size_t size): buf(buf), size(size), pos(0), failed(false) {}
+
+/**
+ * FUNCTION NAME: getByte
+ *
+ * DESCRIPTION: Read one byte
+ */
+unsigned char WireReader::getByte() {
+	if ( failed || pos >= size ) {
+		failed = true;
+		return 0;
+	}
+	return (unsigned char)buf[pos++];
+}
+
+/**
+ * FUNCTION NAME: getFixed32
+ *
+ * DESCRIPTION: Read a little-endian 32-bit integer
+ */
+unsigned int WireReader::getFixed32() {
+	unsigned int v = 0;
+	for ( int i = 0; i < 4; i++ ) {
+		v |= (unsigned int)getByte() << (8 * i);
+	}
+	return failed ? 0 : v;
+}
+
+/**
+ * FUNCTION NAME: getVarint
+ *
+ * DESCRIPTION: Read an unsigned varint
+ */
+unsigned long WireReader::getVarint() {
+	unsigned long v = 0;
+	unsigned char b;
+	for ( int shift = 0; shift < (int)sizeof(unsigned long) * 8; shift += 7 ) {
+		b = getByte();
+		if ( failed ) {
+			return 0;
+		}
+		v |= (unsigned long)(b & 0x7f) << shift;
+		if ( !(b & 0x80) ) {
+			return v;
+		}
+	}
+	// too many continuation bytes
+	failed = true;
+	return 0;
+}
+
+/**
+ * FUNCTION NAME: getSVarint
+ *
+ * DESCRIPTION: Read a signed, zigzag encoded varint
+ */
+long WireReader::getSVarint() {
+	unsigned long v = getVarint();
+	return (long)(v >> 1) ^ -(long)(v & 1);
+}
+
+/**
+ * FUNCTION NAME: ok
+ *
+ * DESCRIPTION: True while everything read so far was well formed
+ */
+bool WireReader::ok() {
+	return !failed;
+}
+
+/**
+ * FUNCTION NAME: atEnd
+ *
+ * DESCRIPTION: True when the whole buffer has been read
+ */
+bool WireReader::atEnd() {
+	return pos == size;
+}
@@ -0,0 +1,55 @@
+/**********************************
+ * FILE NAME: WireFormat.h
+ *
+ * DESCRIPTION: Header file of the byte level encoding used by protocol messages
+ **********************************/
+
+#ifndef _WIREFORMAT_H_
+#define _WIREFORMAT_H_
+
+#include "stdincludes.h"
+
+/**
+ * CLASS NAME: WireWriter
+ *
+ * DESCRIPTION: Appends bytes, little-endian integers and varints to a buffer.
+ * 				A writer over a NULL buffer only counts bytes, so a message can
+ * 				be sized with the same code that encodes it.
+ */
+class WireWriter {
+private:
+	char *buf;
+	size_t pos;
+public:
+	WireWriter(char *buf);
+	void putByte(unsigned char b);
+	void putFixed32(unsigned int v);
+	void putVarint(unsigned long v);
+	void putSVarint(long v);
+	size_t getSize();
+};
+
+/**
+ * CLASS NAME: WireReader
+ *
+ * DESCRIPTION: Reads back what WireWriter wrote. Reading past the end of the
+ * 				buffer or a malformed varint marks the reader as failed and
+ * 				yields zeros from then on.
+ */
+class WireReader {
+private:
+	const char *buf;
+	size_t size;
+	size_t pos;
+	bool failed;
+public:
+	WireReader(const char *buf, size_t size);
+	unsigned char getByte();
+	unsigned int getFixed32();
+	unsigned long getVarint();
+	long getSVarint();
+	bool ok();
+	bool atEnd();
+};
+
+#endif /* _WIREFORMAT_H_ */